@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+"""Publisher component for benchmark runs."""
+
+import json
+import pathlib
+import time
+
+import persipubsub.database
+import persipubsub.environment
+
+# pylint: disable=missing-docstring
+
+
+def _payload(msg_size: int) -> bytes:
+    """
+    Build a benchmark payload of the requested size.
+
+    The first 8 bytes carry the send timestamp in nanoseconds so that the
+    subscriber can compute the end-to-end latency. The remainder is padding.
+
+    :param msg_size: size of the payload in bytes, at least 8
+    :return: payload with the current timestamp encoded in the first 8 bytes
+    """
+    timestamp_ns = int(time.time() * 10**9)
+    return persipubsub.database.int_to_bytes(
+        value=timestamp_ns) + b'\x00' * (msg_size - 8)
+
+
+# pylint: disable=too-many-arguments
+def send_process(path: pathlib.Path,
+                 result_path: pathlib.Path,
+                 num_msg: int,
+                 msg_size: int,
+                 batch_size: int = 1) -> None:
+    """
+    Send timestamped benchmark messages and record the publish rate.
+
+    :param path: to the queue
+    :param result_path: file to which the publish statistics are written
+    :param num_msg: number of messages to send
+    :param msg_size: size of each message in bytes, at least 8
+    :param batch_size: messages per send; batches > 1 use send_many
+    """
+    env = persipubsub.environment.Environment(path=path)
+    pub = env.new_publisher()
+
+    start = time.time()
+    sent = 0
+    while sent < num_msg:
+        if batch_size == 1:
+            pub.send(msg=_payload(msg_size=msg_size))
+            sent += 1
+        else:
+            size = min(batch_size, num_msg - sent)
+            pub.send_many(msgs=[_payload(msg_size=msg_size)] * size)
+            sent += size
+
+    duration = time.time() - start
+
+    result_path.write_text(
+        json.dumps({
+            'sent': sent,
+            'duration': duration
+        }))
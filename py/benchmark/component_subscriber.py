@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+"""Subscriber component for benchmark runs."""
+
+import json
+import pathlib
+import time
+from typing import List
+
+import persipubsub.database
+import persipubsub.environment
+
+# pylint: disable=missing-docstring
+
+
+# pylint: disable=too-many-arguments
+def receive_process(path: pathlib.Path,
+                    result_path: pathlib.Path,
+                    identifier: str,
+                    num_msg: int,
+                    timeout: int = 2,
+                    retries: int = 10,
+                    method_timeout: int = 300) -> None:
+    """
+    Receive benchmark messages and record per-message latencies.
+
+    The first 8 bytes of every payload carry the send timestamp in
+    nanoseconds; the end-to-end latency is the difference to the time at
+    which the message is received.
+
+    :param path: to the queue
+    :param result_path: file to which the receive statistics are written
+    :param identifier: of the subscriber
+    :param num_msg: number of messages to receive
+    :param timeout: time waiting for a message in seconds
+    :param retries: number of tries to check if a message arrived
+    :param method_timeout: time after which the benchmark run fails (secs)
+    """
+    env = persipubsub.environment.Environment(path=path)
+    sub = env.new_subscriber(identifier=identifier)
+
+    latencies_ns = []  # type: List[int]
+
+    start = time.time()
+    while True:
+        if len(latencies_ns) == num_msg:
+            break
+        elif time.time() - start >= method_timeout:
+            raise TimeoutError
+        else:
+            with sub.receive(timeout=timeout, retries=retries) as msg:
+                if msg is not None:
+                    sent_ns = persipubsub.database.bytes_to_int(
+                        array_of_bytes=msg[:8])
+                    latencies_ns.append(int(time.time() * 10**9) - sent_ns)
+
+    duration = time.time() - start
+
+    result_path.write_text(
+        json.dumps({
+            'received': len(latencies_ns),
+            'duration': duration,
+            'latencies_ns': latencies_ns
+        }))
@@ -0,0 +1,231 @@
+#!/usr/bin/env python
+"""Benchmark persipubsub across message sizes, subscriber and process counts."""
+
+import argparse
+import json
+import multiprocessing
+import sys
+import tempfile
+import pathlib
+from typing import Any, List, MutableMapping, Sequence, TextIO
+
+import persipubsub.environment
+import persipubsub.queue
+
+import benchmark.component_publisher
+import benchmark.component_subscriber
+
+DEFAULT_MSG_SIZES = [64, 4096, 65536, 1048576, 4194304]  # type: List[int]
+DEFAULT_PUB_COUNTS = [1, 4]  # type: List[int]
+DEFAULT_SUB_COUNTS = [1, 4]  # type: List[int]
+
+LATENCY_QUANTILES = [0.5, 0.95, 0.99, 0.999]  # type: List[float]
+
+
+def percentile(sorted_values: Sequence[int], quantile: float) -> int:
+    """
+    Compute the quantile of already sorted values by nearest rank.
+
+    :param sorted_values: non-empty values sorted in ascending order
+    :param quantile: requested quantile, e.g. 0.99
+    :return: value at the requested quantile
+    """
+    assert sorted_values
+    index = min(
+        len(sorted_values) - 1, int(round(quantile * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+# pylint: disable=too-many-locals
+def run_combination(msg_size: int, pub_count: int, sub_count: int,
+                    num_msg: int, batch_size: int) -> MutableMapping[str, Any]:
+    """
+    Benchmark one combination of the matrix in separate processes.
+
+    Publishers and subscribers run as separate processes with their own
+    environments so that the numbers include the cross-process LMDB locking
+    behaviour.
+
+    :param msg_size: size of each message in bytes, at least 8
+    :param pub_count: number of publisher processes
+    :param sub_count: number of subscriber processes
+    :param num_msg: number of messages sent by each publisher
+    :param batch_size: messages per send; batches > 1 use send_many
+    :return: measured throughput and latency quantiles
+    """
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        queue_dir = pathlib.Path(tmp_dir) / "queue"
+        queue_dir.mkdir()
+
+        sub_ids = ["sub{}".format(index) for index in range(sub_count)]
+
+        hwm = persipubsub.queue.HighWaterMark(
+            max_messages=2 * pub_count * num_msg,
+            hwm_db_size=persipubsub.queue.DEFAULT_HWM_DB_SIZE)
+
+        env = persipubsub.environment.Environment(path=queue_dir)
+        _ = env.new_control(subscriber_ids=set(sub_ids), high_water_mark=hwm)
+        env.close()
+
+        processes = []
+        for index in range(pub_count):
+            result_path = pathlib.Path(tmp_dir) / "pub{}.json".format(index)
+            processes.append(
+                multiprocessing.Process(
+                    target=benchmark.component_publisher.send_process,
+                    kwargs={
+                        'path': queue_dir,
+                        'result_path': result_path,
+                        'num_msg': num_msg,
+                        'msg_size': msg_size,
+                        'batch_size': batch_size
+                    }))
+
+        for sub_id in sub_ids:
+            result_path = pathlib.Path(tmp_dir) / "{}.json".format(sub_id)
+            processes.append(
+                multiprocessing.Process(
+                    target=benchmark.component_subscriber.receive_process,
+                    kwargs={
+                        'path': queue_dir,
+                        'result_path': result_path,
+                        'identifier': sub_id,
+                        'num_msg': pub_count * num_msg
+                    }))
+
+        for process in processes:
+            process.start()
+
+        for process in processes:
+            process.join()
+            if process.exitcode != 0:
+                raise RuntimeError(
+                    "Benchmark process failed with exit code {}".format(
+                        process.exitcode))
+
+        sent = 0
+        pub_duration = 0.0
+        for index in range(pub_count):
+            result = json.loads(
+                (pathlib.Path(tmp_dir) / "pub{}.json".format(index))
+                .read_text())
+            sent += result['sent']
+            pub_duration = max(pub_duration, result['duration'])
+
+        received = 0
+        sub_duration = 0.0
+        latencies_ns = []  # type: List[int]
+        for sub_id in sub_ids:
+            result = json.loads(
+                (pathlib.Path(tmp_dir) / "{}.json".format(sub_id)).read_text())
+            received += result['received']
+            sub_duration = max(sub_duration, result['duration'])
+            latencies_ns.extend(result['latencies_ns'])
+
+        latencies_ns.sort()
+
+        report = {
+            'msg_size': msg_size,
+            'publishers': pub_count,
+            'subscribers': sub_count,
+            'num_msg': num_msg,
+            'batch_size': batch_size,
+            'send_msgs_per_sec': sent / pub_duration,
+            'send_mb_per_sec': sent * msg_size / pub_duration / 1024**2,
+            'receive_msgs_per_sec': received / sub_duration,
+            'receive_mb_per_sec': received * msg_size / sub_duration / 1024**2
+        }  # type: MutableMapping[str, Any]
+
+        for quantile in LATENCY_QUANTILES:
+            key = 'latency_p{}_ms'.format(
+                str(quantile).replace('0.', '').ljust(2, '0'))
+            report[key] = percentile(
+                sorted_values=latencies_ns, quantile=quantile) / 10**6
+
+        return report
+
+
+def benchmark_matrix(msg_sizes: Sequence[int], pub_counts: Sequence[int],
+                     sub_counts: Sequence[int], num_msg: int, batch_size: int,
+                     stream: TextIO) -> None:
+    """
+    Benchmark all combinations and write one JSON line per combination.
+
+    :param msg_sizes: sizes of the messages in bytes, at least 8
+    :param pub_counts: numbers of publisher processes
+    :param sub_counts: numbers of subscriber processes
+    :param num_msg: number of messages sent by each publisher
+    :param batch_size: messages per send; batches > 1 use send_many
+    :param stream: to which the reports are written
+    """
+    for msg_size in msg_sizes:
+        for pub_count in pub_counts:
+            for sub_count in sub_counts:
+                report = run_combination(
+                    msg_size=msg_size,
+                    pub_count=pub_count,
+                    sub_count=sub_count,
+                    num_msg=num_msg,
+                    batch_size=batch_size)
+
+                stream.write(json.dumps(report, sort_keys=True) + '\n')
+                stream.flush()
+
+
+def main() -> int:
+    """Execute the benchmark matrix given on the command line."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        "--msg_sizes",
+        help="comma-separated message sizes in bytes, at least 8 each",
+        default=",".join(str(size) for size in DEFAULT_MSG_SIZES))
+    parser.add_argument(
+        "--publishers",
+        help="comma-separated numbers of publisher processes",
+        default=",".join(str(count) for count in DEFAULT_PUB_COUNTS))
+    parser.add_argument(
+        "--subscribers",
+        help="comma-separated numbers of subscriber processes",
+        default=",".join(str(count) for count in DEFAULT_SUB_COUNTS))
+    parser.add_argument(
+        "--num_msg",
+        help="number of messages sent by each publisher",
+        type=int,
+        default=1000)
+    parser.add_argument(
+        "--batch_size",
+        help="messages per send; batches > 1 use send_many",
+        type=int,
+        default=1)
+    parser.add_argument(
+        "--output", help="file for the reports; defaults to standard output")
+
+    args = parser.parse_args()
+
+    msg_sizes = [int(size) for size in args.msg_sizes.split(',')]
+    pub_counts = [int(count) for count in args.publishers.split(',')]
+    sub_counts = [int(count) for count in args.subscribers.split(',')]
+
+    if args.output is None:
+        benchmark_matrix(
+            msg_sizes=msg_sizes,
+            pub_counts=pub_counts,
+            sub_counts=sub_counts,
+            num_msg=args.num_msg,
+            batch_size=args.batch_size,
+            stream=sys.stdout)
+    else:
+        with open(args.output, 'wt') as stream:
+            benchmark_matrix(
+                msg_sizes=msg_sizes,
+                pub_counts=pub_counts,
+                sub_counts=sub_counts,
+                num_msg=args.num_msg,
+                batch_size=args.batch_size,
+                stream=stream)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
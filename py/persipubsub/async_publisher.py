@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Publish messages to a queue without blocking the event loop."""
+
+import asyncio
+import concurrent.futures
+import functools
+import pathlib
+from typing import Any, Iterable, Optional, Union
+
+import icontract
+import lmdb
+
+import persipubsub.publisher
+import persipubsub.queue
+
+# pylint: disable=protected-access
+
+#: Worker thread shared by all async publishers of the process. LMDB
+#: serializes writers anyway, so funneling every publish through one thread
+#: gives up no write parallelism while hundreds of queues can be serviced
+#: without one executor thread each.
+_SHARED_WORKER = None  # type: Optional[concurrent.futures.ThreadPoolExecutor]
+
+
+def shared_worker() -> concurrent.futures.ThreadPoolExecutor:
+    """
+    Give the worker thread shared by all async components of the process.
+
+    :return: executor with a single worker thread
+    """
+    global _SHARED_WORKER  # pylint: disable=global-statement
+    if _SHARED_WORKER is None:
+        _SHARED_WORKER = concurrent.futures.ThreadPoolExecutor(max_workers=1)
+    return _SHARED_WORKER
+
+
+def initialize(path: pathlib.Path,
+               autosync: bool,
+               env: lmdb.Environment,
+               loop: Optional[asyncio.AbstractEventLoop] = None,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'AsyncPublisher':
+    """
+    Initialize a new async publisher.
+
+    :param path: to LMDB
+    :param autosync: if True, store data automatically in LMDB
+    :param env: open LMDB environment
+    :param loop: event loop; defaults to the current event loop
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        publisher initializes its own queue
+    :return: AsyncPublisher to send messages from coroutines
+    """
+    publisher = AsyncPublisher()
+    publisher.init(path=path, autosync=autosync, env=env, loop=loop,
+                   queue=queue)
+    return publisher
+
+
+class AsyncPublisher:
+    """
+    Send messages to the queue from coroutines.
+
+    The blocking LMDB commits are run on the worker thread shared by all
+    async components of the process, so awaiting a send suspends the
+    coroutine instead of blocking the event loop.
+
+    :ivar publisher: which writes the messages to the queue
+    :vartype publisher: persipubsub.publisher.Publisher
+    """
+
+    def __init__(self) -> None:
+        """Initialize class object."""
+        self.publisher = None  \
+            # type: Optional[persipubsub.publisher.Publisher]
+        self._loop = None  # type: Optional[asyncio.AbstractEventLoop]
+        self.closed = False
+
+    def init(self,
+             path: Union[pathlib.Path, str],
+             env: Optional[lmdb.Environment] = None,
+             autosync: bool = False,
+             loop: Optional[asyncio.AbstractEventLoop] = None,
+             queue: Optional['persipubsub.queue._Queue'] = None) -> None:
+        """
+        Initialize.
+
+        :param path: path to the queue
+        :param env: open LMDBenvironment
+        :param autosync: if True, store data automatically in LMDB
+        :param loop: event loop; defaults to the current event loop
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the publisher initializes its own queue
+        """
+        # pylint: disable=too-many-arguments
+        self.publisher = persipubsub.publisher.Publisher()
+        self.publisher.init(path=path, env=env, autosync=autosync,
+                            queue=queue)
+        self._loop = loop if loop is not None else asyncio.get_event_loop()
+
+    async def __aenter__(self) -> 'AsyncPublisher':
+        """Enter the context and give the pub prepared in the constructor."""
+        return self
+
+    async def __aexit__(self, exc_type: Any, exc_val: Any,
+                        exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close the underlying publisher."""
+        if self.publisher is not None:
+            self.publisher.close()
+        self.closed = True
+
+    @icontract.require(lambda self: not self.closed)
+    async def send(self, msg: bytes, topic: Optional[str] = None) -> None:
+        """
+        Write one message to the queue on the shared worker thread.
+
+        :param msg: to queue that all subscribers can read it
+        :param topic:
+            of the message; reaches only the subscribers whose subscription
+            matches, None reaches every subscriber
+        """
+        assert self.publisher is not None
+        assert self._loop is not None
+        await self._loop.run_in_executor(
+            shared_worker(),
+            functools.partial(self.publisher.send, msg=msg, topic=topic))
+
+    @icontract.require(lambda self: not self.closed)
+    async def send_many(self,
+                        msgs: Iterable[bytes],
+                        topic: Optional[str] = None) -> None:
+        """
+        Write multiple messages to the queue on the shared worker thread.
+
+        :param msgs: to queue that all subscribers can read them
+        :param topic:
+            of all messages; reaches only the subscribers whose subscription
+            matches, None reaches every subscriber
+        """
+        assert self.publisher is not None
+        assert self._loop is not None
+        await self._loop.run_in_executor(
+            shared_worker(),
+            functools.partial(self.publisher.send_many, msgs=msgs,
+                              topic=topic))
@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""Receive messages from the queue without blocking the event loop."""
+
+import asyncio
+import functools
+import pathlib
+from typing import Any, Optional, Union
+
+import icontract
+import lmdb
+
+import persipubsub.async_publisher
+import persipubsub.queue
+import persipubsub.subscriber
+
+# pylint: disable=protected-access
+
+
+def initialize(path: pathlib.Path,
+               env: lmdb.Environment,
+               identifier: str,
+               loop: Optional[asyncio.AbstractEventLoop] = None,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'AsyncSubscriber':
+    """
+    Initialize a new async subscriber.
+
+    :param path: to LMDB
+    :param env: open LMDB environment
+    :param identifier: of the subscriber
+    :param loop: event loop; defaults to the current event loop
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        subscriber initializes its own queue
+    :return: AsyncSubscriber to receive messages from coroutines
+    """
+    subscriber = AsyncSubscriber()
+    subscriber.init(identifier=identifier, path=path, env=env, loop=loop,
+                    queue=queue)
+    return subscriber
+
+
+class _Receive:
+    """
+    Await the next message and acknowledge it when the context is left.
+
+    The class implements the asynchronous counterpart of the context
+    manager given by :py:meth:`Subscriber.receive`; it exists because
+    contextlib gained asynccontextmanager only in Python 3.7.
+    """
+
+    def __init__(self, subscriber: 'AsyncSubscriber', timeout: int,
+                 retries: int) -> None:
+        """
+        Initialize with the given values.
+
+        :param subscriber: which receives the message
+        :param timeout: time waiting for a message (secs)
+        :param retries: number of tries to check if a msg arrived in the queue
+        """
+        self._subscriber = subscriber
+        self._timeout = timeout
+        self._retries = retries
+        self._msg_id = None  # type: Optional[bytes]
+
+    async def __aenter__(self) -> Optional[bytes]:
+        """Wait for the next message and give it to the coroutine."""
+        subscriber = self._subscriber
+        assert subscriber.subscriber is not None
+        assert subscriber.subscriber.queue is not None
+        assert subscriber.subscriber.identifier is not None
+        assert subscriber._loop is not None
+
+        msg = None
+        end = subscriber._loop.time() + self._timeout
+        while subscriber._loop.time() <= end:
+            msg_id, msg = subscriber.subscriber.queue.front(
+                sub_id=subscriber.subscriber.identifier)
+            if msg is not None:
+                self._msg_id = msg_id
+                break
+            await subscriber._wait_for_notification(
+                timeout=self._timeout / self._retries)
+
+        return msg
+
+    async def __aexit__(self, exc_type: Any, exc_val: Any,
+                        exc_tb: Any) -> None:
+        """Pop the received message on the shared worker thread."""
+        if self._msg_id is None:
+            return
+
+        subscriber = self._subscriber
+        assert subscriber.subscriber is not None
+        assert subscriber.subscriber.queue is not None
+        assert subscriber.subscriber.identifier is not None
+        assert subscriber._loop is not None
+        await subscriber._loop.run_in_executor(
+            persipubsub.async_publisher.shared_worker(),
+            functools.partial(
+                subscriber.subscriber.queue.pop,
+                sub_id=subscriber.subscriber.identifier,
+                msg_id=self._msg_id))
+
+
+class AsyncSubscriber:
+    """
+    Receive messages from the queue in coroutines.
+
+    Waiting for a message suspends the coroutine on the notification FIFO
+    of the subscriber instead of sleeping in a poll loop, so one event loop
+    thread can service hundreds of queues. Where named pipes or file
+    descriptor watching are not available, waiting degrades to an
+    asynchronous sleep between polls.
+
+    :ivar subscriber: which reads the messages from the queue
+    :vartype subscriber: persipubsub.subscriber.Subscriber
+    """
+
+    def __init__(self) -> None:
+        """Initialize class object."""
+        self.subscriber = None  \
+            # type: Optional[persipubsub.subscriber.Subscriber]
+        self._loop = None  # type: Optional[asyncio.AbstractEventLoop]
+        self.closed = False
+
+    def init(self,
+             identifier: str,
+             path: Union[pathlib.Path, str],
+             env: Optional[lmdb.Environment] = None,
+             loop: Optional[asyncio.AbstractEventLoop] = None,
+             queue: Optional['persipubsub.queue._Queue'] = None) -> None:
+        """
+        Initialize.
+
+        :param identifier: unique subscriber id
+        :param path: path to the queue
+        :param env: open LMDBenvironment
+        :param loop: event loop; defaults to the current event loop
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the subscriber initializes its own queue
+        """
+        # pylint: disable=too-many-arguments
+        self.subscriber = persipubsub.subscriber.Subscriber()
+        self.subscriber.init(identifier=identifier, path=path, env=env,
+                             queue=queue)
+        self._loop = loop if loop is not None else asyncio.get_event_loop()
+
+    async def __aenter__(self) -> 'AsyncSubscriber':
+        """Enter the context and give the sub prepared in the constructor."""
+        return self
+
+    async def __aexit__(self, exc_type: Any, exc_val: Any,
+                        exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close the underlying subscriber."""
+        if self.subscriber is not None:
+            self.subscriber.close()
+        self.closed = True
+
+    async def _wait_for_notification(self, timeout: float) -> bool:
+        """
+        Suspend the coroutine until a publisher notifies.
+
+        :param timeout: maximal time to wait for a notification (secs)
+        :return: True if a notification arrived before the timeout
+        """
+        assert self.subscriber is not None
+        assert self.subscriber.listener is not None
+        assert self._loop is not None
+
+        fd = self.subscriber.listener._fd
+        if fd is None:
+            await asyncio.sleep(timeout)
+            return False
+
+        future = self._loop.create_future()
+
+        def on_readable() -> None:
+            """Resolve the future on the first readable event."""
+            if not future.done():
+                future.set_result(True)
+
+        try:
+            self._loop.add_reader(fd, on_readable)
+        except NotImplementedError:
+            # The event loop cannot watch file descriptors
+            # (e.g. the Proactor loop on Windows).
+            await asyncio.sleep(timeout)
+            return False
+
+        try:
+            await asyncio.wait_for(future, timeout)
+        except asyncio.TimeoutError:
+            return False
+        finally:
+            self._loop.remove_reader(fd)
+
+        # Drain the pipe so that pending notifications do not cause
+        # spurious wake-ups on the next wait.
+        self.subscriber.listener.wait(timeout=0)
+        return True
+
+    @icontract.require(lambda timeout: timeout > 0)
+    @icontract.require(lambda retries: retries > 0)
+    @icontract.require(lambda self: not self.closed)
+    def receive(self, timeout: int = 60, retries: int = 10) -> _Receive:
+        """
+        Receive messages from the queue.
+
+        :param timeout:
+            time waiting for a message. If none arrived until the timeout then
+            None will be returned. (secs)
+        :param retries: number of tries to check if a msg arrived in the queue
+        :return:
+            asynchronous context manager which gives a message in bytes
+        """
+        return _Receive(subscriber=self, timeout=timeout, retries=retries)
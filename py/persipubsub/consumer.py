@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Process messages of a shared stream exactly once per consumer group."""
+
+import contextlib
+import datetime
+import pathlib
+from typing import Any, Iterator, Optional, Tuple, Union
+
+import icontract
+import lmdb  # pylint: disable=unused-import
+
+import persipubsub.database
+import persipubsub.notification
+import persipubsub.queue
+
+# pylint: disable=protected-access
+
+#: Default time after which an unacknowledged claim expires (secs)
+DEFAULT_LEASE_TIMEOUT = 60  # type: int
+
+
+def initialize(path: pathlib.Path,
+               env: lmdb.Environment,
+               group_id: str,
+               owner_id: str,
+               lease_timeout: int = DEFAULT_LEASE_TIMEOUT,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'Consumer':
+    """
+    Initialize a new consumer.
+
+    :param path: to LMDB
+    :param env: open LMDB environment
+    :param group_id: of the consumer group which shares the message stream
+    :param owner_id: of this consumer within the group
+    :param lease_timeout:
+        time after which an unacknowledged claim expires (secs)
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        consumer initializes its own queue
+    :return: Consumer to claim and acknowledge messages
+    """
+    # pylint: disable=too-many-arguments
+    consumer = Consumer()
+    consumer.init(
+        group_id=group_id,
+        owner_id=owner_id,
+        path=path,
+        env=env,
+        lease_timeout=lease_timeout,
+        queue=queue)
+    return consumer
+
+
+class Consumer:
+    """
+    Claim messages of a consumer group so each is processed exactly once.
+
+    All consumers of a group compete for the single message stream of the
+    group; the message keys are written once into the database of the
+    group, not once per consumer. A consumer claims the head message by
+    writing a lease (expiry timestamp and owner id) in the same write
+    transaction that reads the message, so no two consumers can claim the
+    same message. When a claim is not acknowledged before the lease
+    expires, the message becomes claimable again.
+
+    :ivar group_id: of the consumer group which shares the message stream
+    :vartype group_id: str
+    :ivar owner_id: of this consumer within the group
+    :vartype owner_id: str
+    :ivar lease_timeout:
+        time after which an unacknowledged claim expires (secs)
+    :vartype lease_timeout: int
+    :ivar queue: from which messages are claimed
+    :vartype queue: persipubsub.queue.Queue
+    :ivar listener: blocks on the notification FIFO between polls
+    :vartype listener: persipubsub.notification.Listener
+    """
+
+    def __init__(self) -> None:
+        """Initialize class object."""
+        self.group_id = None  # type: Optional[str]
+        self.owner_id = None  # type: Optional[str]
+        self.lease_timeout = DEFAULT_LEASE_TIMEOUT  # type: int
+        self.queue = None  # type: Optional[persipubsub.queue._Queue]
+        self.listener = None  \
+            # type: Optional[persipubsub.notification.Listener]
+        self._lease_db = None  # type: Any
+        self.closed = False
+
+    def init(self,
+             group_id: str,
+             owner_id: str,
+             path: Union[pathlib.Path, str],
+             env: Optional[lmdb.Environment] = None,
+             lease_timeout: int = DEFAULT_LEASE_TIMEOUT,
+             queue: Optional['persipubsub.queue._Queue'] = None) -> None:
+        """
+        Initialize.
+
+        :param group_id: of the consumer group which shares the stream
+        :param owner_id: of this consumer within the group
+        :param path: path to the queue
+        :param env: open LMDBenvironment
+        :param lease_timeout:
+            time after which an unacknowledged claim expires (secs)
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the consumer initializes its own queue
+        """
+        # pylint: disable=too-many-arguments
+        self.group_id = group_id
+        self.owner_id = owner_id
+        self.lease_timeout = lease_timeout
+        if queue is not None:
+            self.queue = queue
+        else:
+            self.queue = persipubsub.queue._Queue()  # pylint: disable=protected-access
+            self.queue.init(path=path, env=env)
+        assert self.queue.env is not None
+        assert self.queue.path is not None
+        self._lease_db = self.queue.env.open_db(
+            key=persipubsub.database.lease_db_name(group_id=group_id),
+            create=True)
+        self.listener = persipubsub.notification.Listener(
+            queue_dir=self.queue.path, sub_id=group_id)
+
+    def __enter__(self) -> 'Consumer':
+        """Enter the context and give the consumer prepared in constructor."""
+        return self
+
+    def __exit__(self, exc_type: Any, exc_val: Any, exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close consumer."""
+        if self.listener is not None:
+            self.listener.close()
+        self.closed = True
+
+    @icontract.require(lambda self: not self.closed)
+    def claim(self) -> Tuple[Optional[bytes], Optional[bytes]]:
+        """
+        Claim the oldest claimable message of the group.
+
+        The lease is written in the same write transaction that reads the
+        message, so no other consumer of the group can claim it until the
+        lease expires or the message is released.
+
+        :return: message ID and message; None if no message is claimable
+        """
+        assert self.queue is not None
+        assert self.queue.env is not None
+        assert self.group_id is not None
+        assert self.owner_id is not None
+
+        timestamp_now = int(datetime.datetime.utcnow().timestamp())
+        with self.queue.env.begin(write=True) as txn:
+            cursor = txn.cursor(
+                db=self.queue.sub_db(sub_id=self.group_id))
+            # check if database is not empty
+            if cursor.first():
+                for key in cursor.iternext(keys=True, values=False):
+                    lease = txn.get(key=key, db=self._lease_db)
+                    if lease is not None:
+                        expiry = persipubsub.database.bytes_to_int(
+                            lease[:persipubsub.database.BYTES_LENGTH])
+                        if expiry > timestamp_now:
+                            continue
+
+                    txn.put(
+                        key=key,
+                        value=persipubsub.database.int_to_bytes(
+                            timestamp_now + self.lease_timeout) +
+                        persipubsub.database.str_to_bytes(self.owner_id),
+                        db=self._lease_db)
+
+                    msg = self.queue._get_data(txn=txn, key=key)
+                    return bytes(key), msg
+
+        return None, None
+
+    @icontract.require(lambda self: not self.closed)
+    def ack(self, msg_id: bytes) -> None:
+        """
+        Acknowledge a claimed message and remove it from the group.
+
+        An ack mark for the group is written as for a pop, so the message
+        can be pruned once all other subscribers read it as well.
+
+        :param msg_id: ID of the claimed message
+        :return:
+        """
+        assert self.queue is not None
+        assert self.queue.env is not None
+        assert self.group_id is not None
+        with self.queue.env.begin(write=True) as txn:
+            txn.delete(key=msg_id, db=self._lease_db)
+
+            if not txn.delete(
+                    key=msg_id,
+                    db=self.queue.sub_db(sub_id=self.group_id)):
+                raise RuntimeError("No message to acknowledge")
+
+            txn.put(
+                key=persipubsub.database.ack_key(
+                    msg_id=msg_id, sub_id=self.group_id),
+                value=b'',
+                db=self.queue.ack_db)
+
+    @icontract.require(lambda self: not self.closed)
+    def release(self, msg_id: bytes) -> None:
+        """
+        Give up the claim so that another consumer can claim the message.
+
+        :param msg_id: ID of the claimed message
+        :return:
+        """
+        assert self.queue is not None
+        assert self.queue.env is not None
+        with self.queue.env.begin(write=True) as txn:
+            txn.delete(key=msg_id, db=self._lease_db)
+
+    @icontract.require(lambda timeout: timeout > 0)
+    @icontract.require(lambda retries: retries > 0)
+    @icontract.require(lambda self: not self.closed)
+    @contextlib.contextmanager
+    def receive(self, timeout: int = 60,
+                retries: int = 10) -> Iterator[Optional[bytes]]:
+        """
+        Claim the next message, process it and acknowledge it.
+
+        The message is acknowledged when the context is left without an
+        exception; on an exception the claim is released so that another
+        consumer of the group retries the message.
+
+        :param timeout:
+            time waiting for a message. If none arrived until the timeout then
+            None will be returned. (secs)
+        :param retries: number of tries to check if a msg arrived in the queue
+        :return:
+            Iterator because of decorator which contains a message in bytes
+        """
+        msg = None
+        msg_id = None
+        end = int(datetime.datetime.utcnow().timestamp()) + timeout
+        try:
+            while int(datetime.datetime.utcnow().timestamp()) <= end:
+                msg_id, msg = self.claim()
+                if msg is not None:
+                    break
+                assert self.listener is not None
+                self.listener.wait(timeout=timeout / retries)
+            yield msg
+        except BaseException:
+            if msg_id is not None:
+                self.release(msg_id=msg_id)
+            raise
+
+        if msg_id is not None:
+            self.ack(msg_id=msg_id)
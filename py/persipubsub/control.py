@@ -1,13 +1,16 @@
 #!/usr/bin/env python3
 """Setup and control a persistent queue."""
 
+import os
 import pathlib
-from typing import Any, List, Optional, Set
+import shutil
+from typing import Any, List, MutableMapping, Optional, Set
 
 import icontract
 import lmdb  # pylint: disable=unused-import
 
 import persipubsub.database
+import persipubsub.metrics
 import persipubsub.queue
 
 # pylint: disable=protected-access
@@ -19,7 +22,10 @@ def initialize(path: pathlib.Path,
                high_water_mark: persipubsub.queue.HighWaterMark = persipubsub.
                queue.HighWaterMark(),
                strategy: persipubsub.queue.Strategy = persipubsub.queue.
-               Strategy.PRUNE_FIRST) -> 'Control':
+               Strategy.PRUNE_FIRST,
+               durability: Optional[persipubsub.queue.Durability] = None,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'Control':
     """
     Initialize a new control.
 
@@ -28,8 +34,13 @@ def initialize(path: pathlib.Path,
     :param subscriber_ids: subscribers of the queue
     :param high_water_mark: high water mark limit of the queue
     :param strategy: used to prune queue
+    :param durability: trades crash durability against write throughput
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        control initializes its own queue
     :return: Control to create and maintain queue
     """
+    # pylint: disable=too-many-arguments
     if not path.exists():
         path.mkdir(parents=True, exist_ok=True)
 
@@ -40,30 +51,52 @@ def initialize(path: pathlib.Path,
             queue_dir=path,
             max_reader_num=persipubsub.database.DEFAULT_MAX_READERS,
             max_db_num=persipubsub.database.DEFAULT_MAX_DB_NUM,
-            max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE)
+            max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE,
+            durability=persipubsub.queue.Durability.STRICT
+            if durability is None else durability)
 
-    control = Control(path=path, env=_env)
+    control = Control(path=path, env=_env, queue=queue)
     control.init(
         subscriber_ids=subscriber_ids,
         high_water_mark=high_water_mark,
-        strategy=strategy)
+        strategy=strategy,
+        durability=durability)
     return control
 
 
+def _named_db_keys(env: lmdb.Environment) -> Set[bytes]:
+    """
+    List the names of all named databases in the environment.
+
+    :param env: opened LMDB environment
+    :return: keys of the top-level unnamed database
+    """
+    with env.begin(write=False) as txn:
+        cursor = txn.cursor()
+        return set(cursor.iternext(keys=True, values=False))
+
+
 class Control:
     """Control and maintain a queue."""
 
-    def __init__(self, path: pathlib.Path, env: lmdb.Environment):
+    def __init__(self,
+                 path: pathlib.Path,
+                 env: lmdb.Environment,
+                 queue: Optional['persipubsub.queue._Queue'] = None):
         """
         Initialize control class.
 
         :param path: to the queue.
         :param env: open LMDB environment
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the control initializes its own queue
         """
         self.path = path
         self.queue = None  # type: Optional[persipubsub.queue._Queue]
         self.subscriber_ids = set()  # type: Set[str]
         self.env = env
+        self._provided_queue = queue
         self.closed = False
 
     def __enter__(self) -> 'Control':
@@ -84,17 +117,21 @@ class Control:
              high_water_mark: persipubsub.queue.HighWaterMark = persipubsub.
              queue.HighWaterMark(),
              strategy: persipubsub.queue.Strategy = persipubsub.queue.Strategy.
-             PRUNE_FIRST) -> None:
+             PRUNE_FIRST,
+             durability: Optional[persipubsub.queue.Durability] = None) -> None:
         """
         Initialize control with a (re)initialized queue.
 
         :param subscriber_ids: subscribers of the queue
         :param high_water_mark: high water mark limit of the queue
         :param strategy: used to prune queue
+        :param durability: trades crash durability against write throughput
         :return:
         """
         # pylint: disable=too-many-arguments
         if self.is_initialized():
+            if durability is not None:
+                self.set_durability(durability=durability)
             self._reinitialize_queue()
         else:
             if subscriber_ids is None:
@@ -103,13 +140,20 @@ class Control:
             self._initialize_queue(
                 subscriber_ids=subscriber_ids,
                 high_water_mark=high_water_mark,
-                strategy=strategy)
+                strategy=strategy,
+                durability=persipubsub.queue.Durability.STRICT
+                if durability is None else durability)
 
     def _reinitialize_queue(self) -> None:
         """Reinitialize the queue which is maintained by the control."""
-        self.queue = persipubsub.queue._Queue(
-        )  # type: persipubsub.queue._Queue
-        self.queue.init(path=self.path, env=self.env)
+        if self._provided_queue is not None:
+            # The shared queue was already initialized by the environment;
+            # repeating the handshake would only redo the same reads.
+            self.queue = self._provided_queue
+        else:
+            self.queue = persipubsub.queue._Queue(
+            )  # type: persipubsub.queue._Queue
+            self.queue.init(path=self.path, env=self.env)
         assert self.queue.subscriber_ids is not None
         self.subscriber_ids = set(self.queue.subscriber_ids)
 
@@ -120,15 +164,20 @@ class Control:
                           high_water_mark: persipubsub.queue.
                           HighWaterMark = persipubsub.queue.HighWaterMark(),
                           strategy: persipubsub.queue.Strategy = persipubsub.
-                          queue.Strategy.PRUNE_FIRST) -> None:
+                          queue.Strategy.PRUNE_FIRST,
+                          durability: persipubsub.queue.
+                          Durability = persipubsub.queue.Durability.STRICT
+                          ) -> None:
         """
         Initialize queue.
 
         :param subscriber_ids: subscribers of the queue
         :param high_water_mark: high water mark limit of the queue
         :param strategy: used to prune queue
+        :param durability: trades crash durability against write throughput
         :return:
         """
+        # pylint: disable=too-many-arguments
         self.subscriber_ids = set(subscriber_ids)
         # Databases needed for queue:
         # 5 queues (data db, meta db, pending db, queue db, subscriber db)
@@ -136,6 +185,7 @@ class Control:
 
         self.set_hwm(hwm=high_water_mark)
         self.set_strategy(strategy=strategy)
+        self.set_durability(durability=durability)
 
         for sub in self.subscriber_ids:
             self._add_sub(sub_id=sub)
@@ -161,7 +211,13 @@ class Control:
 
     @icontract.require(lambda self: not self.closed)
     @icontract.ensure(
-        lambda self: self.env.stat()['entries'] == 5, enabled=icontract.SLOW)
+        lambda self: _named_db_keys(env=self.env) == {
+            persipubsub.database.DATA_DB, persipubsub.database.META_DB,
+            persipubsub.database.PENDING_DB, persipubsub.database.QUEUE_DB,
+            persipubsub.database.SUBSCRIBER_DB, persipubsub.database.CURSOR_DB,
+            persipubsub.database.ZERO_PENDING_DB, persipubsub.database.ACK_DB
+        },
+        enabled=icontract.SLOW)
     def clear_all_subscribers(self) -> None:
         """Clear all subscriber and delete all messages for queue."""
         assert self.queue is not None
@@ -177,9 +233,29 @@ class Control:
                 except lmdb.NotFoundError:
                     pass
 
+            try:
+                cursor_db = self.queue.env.open_db(
+                    key=persipubsub.database.CURSOR_DB, txn=txn, create=False)
+                txn.drop(db=cursor_db, delete=False)
+            except lmdb.NotFoundError:
+                pass
+
             pending_db = self.queue.env.open_db(
                 key=persipubsub.database.PENDING_DB, txn=txn, create=False)
             txn.drop(db=pending_db, delete=False)
+            try:
+                zero_pending_db = self.queue.env.open_db(
+                    key=persipubsub.database.ZERO_PENDING_DB, txn=txn,
+                    create=False)
+                txn.drop(db=zero_pending_db, delete=False)
+            except lmdb.NotFoundError:
+                pass
+            try:
+                ack_db = self.queue.env.open_db(
+                    key=persipubsub.database.ACK_DB, txn=txn, create=False)
+                txn.drop(db=ack_db, delete=False)
+            except lmdb.NotFoundError:
+                pass
             meta_db = self.queue.env.open_db(
                 key=persipubsub.database.META_DB, txn=txn, create=False)
             txn.drop(db=meta_db, delete=False)
@@ -187,6 +263,155 @@ class Control:
                 key=persipubsub.database.DATA_DB, txn=txn, create=False)
             txn.drop(db=data_db, delete=False)
 
+            for segment in self.queue._existing_data_segments(txn=txn):
+                seg_db = self.queue.env.open_db(
+                    key=persipubsub.database.data_segment_db_name(
+                        segment=segment),
+                    txn=txn,
+                    create=False)
+                txn.drop(db=seg_db, delete=True)
+            self.queue._segment_dbs.clear()
+
+            # All messages are gone, so the running counters start over.
+            txn.put(
+                key=persipubsub.database.NUM_MSGS_KEY,
+                value=persipubsub.database.int_to_bytes(0),
+                db=self.queue.queue_db)
+            txn.put(
+                key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                value=persipubsub.database.int_to_bytes(0),
+                db=self.queue.queue_db)
+
+        shutil.rmtree(
+            (self.path / persipubsub.database.BLOB_DIR).as_posix(),
+            ignore_errors=True)
+
+    @icontract.require(lambda self: not self.closed)
+    def set_blob_threshold(self, threshold_bytes: Optional[int]) -> None:
+        """
+        Set the size from which payloads are stored as sidecar blob files.
+
+        Payloads of at least this size are written to blob files under the
+        queue directory and only a fixed-size reference is kept in the data
+        database, which keeps the B-tree compact and gives large payloads a
+        memory-mapped, zero-copy read path.
+
+        In order to apply a changed threshold, publishers need to open a
+        new persipubsub environment. Blobs written earlier remain readable
+        after the threshold is changed or disabled.
+
+        :param threshold_bytes:
+            minimal payload size stored as a blob; None keeps all payloads
+            inline
+        :return:
+        """
+        with self.env.begin(write=True) as txn:
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            if threshold_bytes is None:
+                txn.delete(
+                    key=persipubsub.database.BLOB_THRESHOLD_KEY, db=queue_db)
+            else:
+                txn.put(
+                    key=persipubsub.database.BLOB_THRESHOLD_KEY,
+                    value=persipubsub.database.int_to_bytes(threshold_bytes),
+                    db=queue_db)
+
+    @icontract.require(lambda self: not self.closed)
+    def set_compression(self, codec: Optional[str]) -> None:
+        """
+        Set the codec with which message payloads are compressed.
+
+        The codec is recorded in queue_db and applied when publishers put
+        messages; the receive path reverses the compression based on the
+        per-value marker, so uncompressed legacy messages and messages
+        written with a different codec still read.
+
+        In order to apply a changed codec, publishers need to open a new
+        persipubsub environment.
+
+        :param codec:
+            one of persipubsub.queue.COMPRESSION_CODECS; None stores the
+            payloads verbatim
+        :return:
+        """
+        if codec is not None \
+                and codec not in persipubsub.queue.COMPRESSION_CODECS:
+            raise ValueError("Unknown compression codec: '{}' choosen.".format(
+                codec))
+
+        with self.env.begin(write=True) as txn:
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            if codec is None:
+                txn.delete(
+                    key=persipubsub.database.COMPRESSION_KEY, db=queue_db)
+            else:
+                txn.put(
+                    key=persipubsub.database.COMPRESSION_KEY,
+                    value=persipubsub.database.str_to_bytes(codec),
+                    db=queue_db)
+
+    @icontract.require(lambda self: not self.closed)
+    @icontract.require(
+        lambda sample_interval: sample_interval is None or sample_interval > 0)
+    def set_residency_sampling(self, sample_interval: Optional[int]) -> None:
+        """
+        Set the sampling interval for queue-residency tracing.
+
+        One in sample_interval received messages is traced: the receive
+        path subtracts the publish timestamp carried in the message ID from
+        the current time and records the residency in a per-subscriber
+        histogram which is exposed with the metrics snapshot. Messages
+        which are not sampled pay nothing.
+
+        Components which share the environment with this control pick up
+        the changed interval immediately; others need to open a new
+        persipubsub environment.
+
+        :param sample_interval:
+            one in this many received messages is traced; None switches
+            the tracing off
+        :return:
+        """
+        with self.env.begin(write=True) as txn:
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            if sample_interval is None:
+                txn.delete(
+                    key=persipubsub.database.RESIDENCY_SAMPLE_KEY,
+                    db=queue_db)
+            else:
+                txn.put(
+                    key=persipubsub.database.RESIDENCY_SAMPLE_KEY,
+                    value=persipubsub.database.int_to_bytes(sample_interval),
+                    db=queue_db)
+
+        if self.queue is not None:
+            self.queue.residency_sample_interval = \
+                0 if sample_interval is None else sample_interval
+
+    @icontract.require(lambda self: not self.closed)
+    def metrics(self) -> MutableMapping[str, Any]:
+        """
+        Snapshot the metrics of the queue.
+
+        The latency histograms and counters cover the operations which the
+        current process performed; the current depth and data size of the
+        queue are read from the persistent running counters and hence cover
+        all processes.
+
+        Use persipubsub.metrics.format_prometheus to render the snapshot in
+        the Prometheus text exposition format.
+
+        :return: counters, latency histograms, depth and data size
+        """
+        assert self.queue is not None
+        snapshot = self.queue.metrics.snapshot()
+        snapshot['num_msgs'] = self.queue.count_msgs()
+        snapshot['data_size_bytes'] = self.queue.check_current_lmdb_size()
+        return snapshot
+
     @icontract.require(lambda self: not self.closed)
     def prune_dangling_messages(self) -> None:
         """Prune all dangling messages from the LMDB."""
@@ -194,6 +419,46 @@ class Control:
         persipubsub.queue._prune_dangling_messages_for(
             queue=self.queue, subscriber_ids=set(self.subscriber_ids))
 
+    @icontract.require(lambda self: not self.closed)
+    def compact(self) -> None:
+        """
+        Rewrite the queue into a compacted data file and swap it in.
+
+        LMDB never shrinks its data file, so after heavy churn the file
+        stays at high-water-mark size with fragmented pages. The
+        compacting copy rewrites the live pages densely into a snapshot
+        beside the live environment; the snapshot is then atomically
+        swapped in while a write transaction fences all writers, so no
+        committed message can land between the snapshot and the swap.
+
+        The open environment keeps the mapping of the old file, hence the
+        environment must be reopened before any further write. Use
+        Environment.compact() which reopens the environment and
+        re-attaches every component created from it.
+        """
+        assert self.queue is not None
+        assert self.queue.env is not None
+        assert self.queue.path is not None
+
+        compact_dir = \
+            self.queue.path / persipubsub.database.COMPACT_DIR
+        if compact_dir.exists():
+            shutil.rmtree(compact_dir.as_posix())
+        compact_dir.mkdir(parents=True)
+
+        txn = self.queue.env.begin(write=True)
+        try:
+            self.queue.env.copy(path=compact_dir.as_posix(), compact=True)
+            os.replace(
+                src=(compact_dir /
+                     persipubsub.database.DATA_FILENAME).as_posix(),
+                dst=(self.queue.path /
+                     persipubsub.database.DATA_FILENAME).as_posix())
+        finally:
+            txn.abort()
+
+        shutil.rmtree(compact_dir.as_posix())
+
     @icontract.ensure(
         lambda self, sub_id: not self._has_messages_for(sub_id=sub_id),
         enabled=icontract.SLOW)
@@ -222,19 +487,15 @@ class Control:
 
             txn.drop(db=sub_db, delete=False)
 
-            pending_db = self.queue.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
+            ack_db = self.queue.env.open_db(
+                key=persipubsub.database.ACK_DB, txn=txn, create=True)
 
             for key in message_ids:
-                pending_value = txn.get(key=key, db=pending_db)
-                pending_num = persipubsub.database.bytes_to_int(pending_value)
-                decreased_pending_num = pending_num - 1
-                assert decreased_pending_num >= 0
                 txn.put(
-                    key=key,
-                    value=persipubsub.database.int_to_bytes(
-                        decreased_pending_num),
-                    db=pending_db)
+                    key=persipubsub.database.ack_key(
+                        msg_id=key, sub_id=sub_id),
+                    value=b'',
+                    db=ack_db)
 
     def _has_sub(self, sub_id: str) -> bool:
         """
@@ -259,11 +520,15 @@ class Control:
     @icontract.ensure(
         lambda self, sub_id: self._has_sub(sub_id=sub_id),
         enabled=icontract.SLOW)
-    def _add_sub(self, sub_id: str) -> None:
+    def _add_sub(self, sub_id: str,
+                 topic_pattern: Optional[str] = None) -> None:
         """
         Add a subscriber and create its corresponding database.
 
         :param sub_id: identifier of the subscriber which should be added
+        :param topic_pattern:
+            fnmatch-style pattern of the topics which the subscriber
+            receives; None matches every message
         """
         with self.env.begin(write=True) as txn:
             _ = self.env.open_db(
@@ -274,7 +539,104 @@ class Control:
             subscriber_db = self.env.open_db(
                 persipubsub.database.SUBSCRIBER_DB, txn=txn, create=True)
             txn.put(
-                key=persipubsub.database.str_to_bytes(sub_id), db=subscriber_db)
+                key=persipubsub.database.str_to_bytes(sub_id),
+                value=b'' if topic_pattern is None else
+                persipubsub.database.str_to_bytes(topic_pattern),
+                db=subscriber_db)
+
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            persipubsub.queue._add_to_counter(
+                txn=txn,
+                queue_db=queue_db,
+                key=persipubsub.database.CONFIG_EPOCH_KEY,
+                delta=1)
+
+        # Refresh the cached metadata so components which share the queue
+        # with this control pick up the subscriber immediately.
+        if self.queue is not None:
+            assert self.queue.subscriber_ids is not None
+            self.queue.subscriber_ids.add(sub_id)
+            self.queue.subscriber_topics[sub_id] = topic_pattern
+            self.queue.sub_dbs[sub_id] = self.env.open_db(
+                key=persipubsub.database.str_to_bytes(sub_id), create=False)
+
+    @icontract.require(lambda self: not self.closed)
+    def add_cursor_subscriber(self, sub_id: str) -> None:
+        """
+        Add a subscriber whose state is a single cursor position.
+
+        The publish path writes no key for cursor subscribers, so the
+        publish cost is independent of their number. A cursor subscriber
+        receives every message (topic patterns do not apply) and is popped
+        by advancing its position with a single 8-byte value update.
+        Unconsumed messages are retained until every cursor subscriber
+        passed them or the message timeout expires.
+
+        :param sub_id: identifier of the subscriber which should be added
+        :return:
+        """
+        with self.env.begin(write=True) as txn:
+            subscriber_db = self.env.open_db(
+                persipubsub.database.SUBSCRIBER_DB, txn=txn, create=True)
+            txn.put(
+                key=persipubsub.database.str_to_bytes(sub_id),
+                value=persipubsub.database.CURSOR_SUBSCRIBER_MARKER,
+                db=subscriber_db)
+
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            persipubsub.queue._add_to_counter(
+                txn=txn,
+                queue_db=queue_db,
+                key=persipubsub.database.CONFIG_EPOCH_KEY,
+                delta=1)
+
+        if self.queue is not None:
+            self.queue.cursor_subscriber_ids.add(sub_id)
+
+    @icontract.require(lambda self: not self.closed)
+    def add_consumer_group(self, group_id: str,
+                           topic_pattern: Optional[str] = None) -> None:
+        """
+        Add a consumer group whose consumers compete for one stream.
+
+        The group subscribes to the queue like a single subscriber, so
+        every message key is written once regardless of the number of
+        consumers in the group. Consumers claim the messages with leases
+        (see :py:class:`persipubsub.consumer.Consumer`), so each message
+        is processed by exactly one consumer of the group.
+
+        :param group_id: identifier of the consumer group
+        :param topic_pattern:
+            fnmatch-style pattern of the topics which the group receives;
+            None matches every message
+        :return:
+        """
+        self._add_sub(sub_id=group_id, topic_pattern=topic_pattern)
+
+    @icontract.require(lambda self: not self.closed)
+    def set_subscription(self, sub_id: str,
+                         topic_pattern: Optional[str]) -> None:
+        """
+        Register the topic pattern of a subscriber.
+
+        Messages published with a topic are written only into the databases
+        of the subscribers whose pattern matches, so a subscriber which
+        cares about a fraction of the traffic neither stores nor pops the
+        rest.
+
+        Publishers which share the queue of this control's environment pick
+        up the changed subscription immediately; publishers of other
+        environments need to open a new persipubsub environment.
+
+        :param sub_id: identifier of the subscriber
+        :param topic_pattern:
+            fnmatch-style pattern of the topics which the subscriber
+            receives; None matches every message
+        :return:
+        """
+        self._add_sub(sub_id=sub_id, topic_pattern=topic_pattern)
 
     @icontract.ensure(
         lambda self, sub_id: not self._has_sub(sub_id=sub_id),
@@ -308,19 +670,26 @@ class Control:
                 # Subscriber doesn't exist. Post condition is met.
                 pass
 
-            pending_db = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
+            ack_db = self.env.open_db(
+                key=persipubsub.database.ACK_DB, txn=txn, create=True)
 
             for key in msg_of_sub:
-                pending_value = txn.get(key=key, db=pending_db)
-                pending_num = persipubsub.database.bytes_to_int(pending_value)
-                decreased_pending_num = pending_num - 1
-                assert decreased_pending_num >= 0
                 txn.put(
-                    key=key,
-                    value=persipubsub.database.int_to_bytes(
-                        decreased_pending_num),
-                    db=pending_db)
+                    key=persipubsub.database.ack_key(
+                        msg_id=key, sub_id=sub_id),
+                    value=b'',
+                    db=ack_db)
+
+            try:
+                cursor_db = self.env.open_db(
+                    key=persipubsub.database.CURSOR_DB, txn=txn, create=False)
+                txn.delete(
+                    key=persipubsub.database.str_to_bytes(sub_id),
+                    db=cursor_db)
+            except lmdb.NotFoundError:
+                # The subscriber has no cursor position. Post condition is
+                # met.
+                pass
 
             subscriber_db = self.env.open_db(
                 persipubsub.database.SUBSCRIBER_DB, txn=txn, create=False)
@@ -336,6 +705,21 @@ class Control:
             if sub_id in self.subscriber_ids:
                 self.subscriber_ids.remove(sub_id)
 
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            persipubsub.queue._add_to_counter(
+                txn=txn,
+                queue_db=queue_db,
+                key=persipubsub.database.CONFIG_EPOCH_KEY,
+                delta=1)
+
+        if self.queue is not None:
+            assert self.queue.subscriber_ids is not None
+            self.queue.subscriber_ids.discard(sub_id)
+            self.queue.subscriber_topics.pop(sub_id, None)
+            self.queue.sub_dbs.pop(sub_id, None)
+            self.queue.cursor_subscriber_ids.discard(sub_id)
+
     @icontract.require(lambda self: not self.closed)
     def set_hwm(self, hwm: persipubsub.queue.HighWaterMark) -> None:
         """
@@ -396,6 +780,28 @@ class Control:
                 value=persipubsub.database.str_to_bytes(str(strategy.name)),
                 db=queue_db)
 
+    @icontract.require(lambda self: not self.closed)
+    def set_durability(self,
+                       durability: persipubsub.queue.Durability) -> None:
+        """
+        Record the durability profile of the queue.
+
+        The profile is recorded so that all processes which open the queue
+        without an explicit profile agree on the same LMDB flags. In order
+        to change the durability of an already opened queue, you need to
+        open a new persipubsub environment.
+
+        :param durability: trades crash durability against write throughput
+        :return:
+        """
+        with self.env.begin(write=True) as txn:
+            queue_db = self.env.open_db(
+                persipubsub.database.QUEUE_DB, txn=txn, create=True)
+            txn.put(
+                key=persipubsub.database.DURABILITY_KEY,
+                value=persipubsub.database.str_to_bytes(str(durability.name)),
+                db=queue_db)
+
     def _has_messages_for(self, sub_id: str) -> bool:
         with self.env.begin(write=False) as txn:
             sub_db = self.env.open_db(
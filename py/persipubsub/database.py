@@ -1,6 +1,6 @@
 #!/usr/bin/env python
 """Set default values of persipubsub and offers encoding tools."""
-from typing import Set
+from typing import Dict, Optional, Set
 
 import lmdb
 
@@ -16,10 +16,17 @@ BYTES_ORDER = 'big'  # type: str
 #: The data database the actual data.
 #: The data is stored in the following (key | value) pair: (msg_id | data)
 DATA_DB = "data_db".encode(ENCODING)
-#: The pending database stores how many subscriber still need to read a message.
+#: The pending database stores how many subscribers received a message when
+#: it was put. The count is not touched when a message is acknowledged --
+#: acknowledgments are blind writes into the ack database and evaluated
+#: lazily during pruning, so subscribers do not serialize on one counter.
 #: The data is stored in the following (key | value) pair:
 #: (msg_id | pending subscriber)
 PENDING_DB = "pending_db".encode(ENCODING)
+#: The ack database stores one entry per acknowledged (message, subscriber)
+#: pair. The data is stored in the following (key | value) pair:
+#: (msg_id + subscriber_id | -)
+ACK_DB = "ack_db".encode(ENCODING)
 #: The meta database stores the timestamp when the message was sent.
 #: The data is stored in the following (key | value) pair: (msg_id | timestamp)
 META_DB = "meta_db".encode(ENCODING)
@@ -27,10 +34,75 @@ META_DB = "meta_db".encode(ENCODING)
 #: The data is stored in the following (key | value) pair:
 #: (queue_pth | all queue data)
 QUEUE_DB = "queue_db".encode(ENCODING)
-#: The subscriber database stores the subscriber ids of the queue.
-#: The data is stored in the following (key | value) pair: (subscriber_id | -)
+#: The subscriber database stores the subscriber ids of the queue together
+#: with their optional topic pattern.
+#: The data is stored in the following (key | value) pair:
+#: (subscriber_id | topic pattern or -)
 SUBSCRIBER_DB = "subscriber_db".encode(ENCODING)
 
+#: The message data is segmented into generation-numbered databases named
+#: data_db_<generation>. The generation is derived from the high bits of the
+#: monotonic message ID, so pruning old messages can drop whole segment
+#: databases instead of deleting key by key.
+DATA_SEGMENT_PREFIX = "data_db_"  # type: str
+#: Number of low bits of the message ID ignored when deriving its segment.
+#: The message ID is a nanosecond timestamp, hence one segment spans
+#: 2**35 ns, i.e. roughly half a minute.
+DATA_SEGMENT_SHIFT = 35  # type: int
+
+#: The zero-pending database indexes the messages whose pending subscriber
+#: count dropped to zero. It is maintained when the count is decremented,
+#: so pruning reads the index instead of scanning the whole pending
+#: database. The data is stored in the following (key | value) pair:
+#: (msg_id | -)
+ZERO_PENDING_DB = "zero_pending_db".encode(ENCODING)
+#: Set once the zero-pending index was populated, so queues written before
+#: the index existed are migrated exactly once
+ZERO_PENDING_INDEXED_KEY = "zero_pending_indexed".encode(ENCODING)
+
+#: The cursor database stores the last consumed message ID per
+#: cursor-position subscriber.
+#: The data is stored in the following (key | value) pair:
+#: (subscriber_id | msg_id)
+CURSOR_DB = "cursor_db".encode(ENCODING)
+#: Value in the subscriber database which marks a cursor-position
+#: subscriber. The NUL bytes rule out a collision with a topic pattern.
+CURSOR_SUBSCRIBER_MARKER = b'\x00persipubsub_cursor\x00'
+
+#: Every consumer group has its own lease database named
+#: lease_db_<group_id>. The data is stored in the following (key | value)
+#: pair: (msg_id | expiry timestamp + owner id)
+LEASE_DB_PREFIX = "lease_db_"  # type: str
+
+#: Directory below the queue directory into which the compacting copy is
+#: written before it is swapped in
+COMPACT_DIR = ".compact"  # type: str
+#: Name of the LMDB data file within the queue directory
+DATA_FILENAME = "data.mdb"  # type: str
+
+#: Directory below the queue directory which holds the sidecar blob files
+#: of large messages, one subdirectory per data segment.
+BLOB_DIR = ".blobs"  # type: str
+#: Marker with which the data value of a message stored as a sidecar blob
+#: starts. The marker contains a NUL byte on both ends so that it cannot
+#: collide with text payloads and is long enough that a collision with
+#: binary payloads is practically impossible.
+BLOB_MARKER = b'\x00persipubsub_blob\x00'
+#: Payloads of at least this size are spilled to sidecar blob files
+BLOB_THRESHOLD_KEY = "blob_threshold_bytes".encode(ENCODING)
+
+#: Marker with which a compressed data value starts, followed by the codec
+#: name and a NUL byte. As with BLOB_MARKER, the NUL bytes rule out
+#: collisions with text payloads and make collisions with binary payloads
+#: practically impossible, so uncompressed legacy values still read.
+COMPRESSION_MARKER = b'\x00persipubsub_compressed\x00'
+#: Codec with which message payloads are compressed
+COMPRESSION_KEY = "compression".encode(ENCODING)
+
+#: One in this many received messages is sampled for queue-residency
+#: tracing; absent means the sampling is off
+RESIDENCY_SAMPLE_KEY = "residency_sample_interval".encode(ENCODING)
+
 # queues default
 #: Default maximal LMDB size (in bytes)
 DEFAULT_MAX_DB_SIZE = 32 * 1024**3  # type: int
@@ -47,6 +119,15 @@ HWM_DB_SIZE_KEY = "hwm_db_size".encode(ENCODING)
 MAX_MESSAGES_KEY = "max_messages".encode(ENCODING)
 MESSAGE_TIMEOUT_KEY = "message_timeout".encode(ENCODING)
 STRATEGY_KEY = "strategy".encode(ENCODING)
+DURABILITY_KEY = "durability".encode(ENCODING)
+#: Version counter of the queue configuration. Controls bump it on every
+#: subscriber mutation, so publishers detect a changed subscriber set with
+#: one 8-byte read per publish instead of iterating the subscriber database.
+CONFIG_EPOCH_KEY = "config_epoch".encode(ENCODING)
+#: Running count of the messages stored in the queue
+NUM_MSGS_KEY = "num_msgs".encode(ENCODING)
+#: Running total of the stored message payloads (in bytes)
+DATA_SIZE_BYTES_KEY = "data_size_bytes".encode(ENCODING)
 
 
 def str_to_bytes(string: str) -> bytes:
@@ -89,12 +170,83 @@ def bytes_to_int(array_of_bytes: bytes) -> int:
     return int.from_bytes(bytes=array_of_bytes, byteorder=BYTES_ORDER)
 
 
+def data_segment_of(msg_id: bytes) -> int:
+    """
+    Derive the generation number of the data segment of a message.
+
+    :param msg_id: message ID as 8 bytes
+    :return: generation number of the segment which holds the message data
+    """
+    return bytes_to_int(msg_id) >> DATA_SEGMENT_SHIFT
+
+
+def data_segment_db_name(segment: int) -> bytes:
+    """
+    Resolve the name of a generation-numbered data segment database.
+
+    :param segment: generation number of the segment
+    :return: name of the named database which holds the segment
+    """
+    return str_to_bytes(DATA_SEGMENT_PREFIX + str(segment))
+
+
+def ack_key(msg_id: bytes, sub_id: str) -> bytes:
+    """
+    Compose the ack database key of a (message, subscriber) pair.
+
+    :param msg_id: message ID as 8 bytes
+    :param sub_id: Subscriber ID
+    :return: composite key of the acknowledgment
+    """
+    return msg_id + str_to_bytes(sub_id)
+
+
+def lease_db_name(group_id: str) -> bytes:
+    """
+    Resolve the name of the lease database of a consumer group.
+
+    :param group_id: identifier of the consumer group
+    :return: name of the named database which holds the leases
+    """
+    return str_to_bytes(LEASE_DB_PREFIX + group_id)
+
+
+def retrieve_durability(env: lmdb.Environment) -> str:
+    """
+    Retrieve the durability profile recorded for the queue.
+
+    Queues written before durability profiles existed have no record and
+    default to the fully synchronous profile.
+
+    :param env: environment that stores queue data
+    :return: name of the recorded durability profile
+    """
+    with env.begin(write=False) as txn:
+        try:
+            queue_db = env.open_db(key=QUEUE_DB, txn=txn, create=False)
+        except lmdb.NotFoundError:
+            return 'STRICT'
+
+        value = txn.get(key=DURABILITY_KEY, db=queue_db)
+
+    if value is None:
+        return 'STRICT'
+
+    return bytes_to_str(value)
+
+
 class QueueData:
     """Hold initialization data for queue."""
 
-    def __init__(self, message_timeout: int, max_messages: int,
-                 hwm_db_size: int, strategy: str,
-                 subscriber_ids: Set[str]) -> None:
+    def __init__(self,
+                 message_timeout: int,
+                 max_messages: int,
+                 hwm_db_size: int,
+                 strategy: str,
+                 subscriber_ids: Set[str],
+                 subscriber_topics: Optional[
+                     Dict[str, Optional[str]]] = None,
+                 cursor_subscriber_ids: Optional[Set[str]] = None) -> None:
         """
         Initialize with the given values.
 
@@ -104,6 +256,11 @@ class QueueData:
         :param hwm_db_size: high water mark for total size of LMDB (in bytes)
         :param strategy: pruning strategy
         :param subscriber_ids: List of subscribers
+        :param subscriber_topics:
+            topic pattern per subscriber; None matches every message
+        :param cursor_subscriber_ids:
+            subscribers whose state is a cursor position instead of a copy
+            of every pending message key
         """
         # pylint: disable=too-many-arguments
         self.message_timeout = message_timeout
@@ -111,6 +268,10 @@ class QueueData:
         self.hwm_db_size = hwm_db_size
         self.strategy = strategy
         self.subscriber_ids = subscriber_ids
+        self.subscriber_topics = {} if subscriber_topics is None \
+            else subscriber_topics  # type: Dict[str, Optional[str]]
+        self.cursor_subscriber_ids = set() if cursor_subscriber_ids is None \
+            else cursor_subscriber_ids  # type: Set[str]
 
 
 def retrieve_queue_data(env: lmdb.Environment) -> QueueData:
@@ -133,14 +294,21 @@ def retrieve_queue_data(env: lmdb.Environment) -> QueueData:
 
         subscriber_db = env.open_db(key=SUBSCRIBER_DB, txn=txn, create=False)
         sub_cursor = txn.cursor(db=subscriber_db)
-        subscriber_ids = set(
-            bytes_to_str(subscriber_id)
-            for subscriber_id in sub_cursor.iternext(values=False))
+        subscriber_topics = {}  # type: Dict[str, Optional[str]]
+        cursor_subscriber_ids = set()  # type: Set[str]
+        for subscriber_id, pattern in sub_cursor.iternext(values=True):
+            if pattern == CURSOR_SUBSCRIBER_MARKER:
+                cursor_subscriber_ids.add(bytes_to_str(subscriber_id))
+            else:
+                subscriber_topics[bytes_to_str(subscriber_id)] = \
+                    bytes_to_str(pattern) if pattern else None
 
     queue_data = QueueData(
         message_timeout=message_timeout,
         max_messages=max_messages,
         hwm_db_size=hwm_db_size,
         strategy=strategy,
-        subscriber_ids=subscriber_ids)
+        subscriber_ids=set(subscriber_topics.keys()),
+        subscriber_topics=subscriber_topics,
+        cursor_subscriber_ids=cursor_subscriber_ids)
     return queue_data
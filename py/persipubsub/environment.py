@@ -1,11 +1,15 @@
 #!/usr/bin/env python3
 """Create new persipubsub components."""
 
+import asyncio
 import pathlib
-from typing import Any, Optional, Set
+from typing import Any, Callable, List, Optional, Set
 
 import icontract
 
+import persipubsub.async_publisher
+import persipubsub.async_subscriber
+import persipubsub.consumer
 import persipubsub.control
 import persipubsub.database
 import persipubsub.publisher
@@ -32,13 +36,24 @@ class Environment:
 
     :ivar path: to the queue
     :vartype path: pathlib.Path
+    :ivar durability: profile with which the environment was opened
+    :vartype durability: persipubsub.queue.Durability
     """
 
-    def __init__(self, path: pathlib.Path) -> None:
+    def __init__(self,
+                 path: pathlib.Path,
+                 durability: Optional[
+                     persipubsub.queue.Durability] = None) -> None:
         """
         Initialize.
 
+        The durability profile defaults to the one recorded in the queue, so
+        all processes which open the queue agree; new queues default to the
+        fully synchronous STRICT profile. An explicitly given profile wins
+        and is recorded when a control is created.
+
         :param path: to the queue
+        :param durability: trades crash durability against write throughput
         """
         self.path = path
         self._env = persipubsub.queue._initialize_environment(
@@ -46,6 +61,24 @@ class Environment:
             max_reader_num=persipubsub.database.DEFAULT_MAX_READERS,
             max_db_num=persipubsub.database.DEFAULT_MAX_DB_NUM,
             max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE)
+
+        if durability is None:
+            durability = persipubsub.queue._parse_durability(
+                identifier=persipubsub.database.retrieve_durability(
+                    env=self._env))
+
+        if durability != persipubsub.queue.Durability.STRICT:
+            self._env.close()
+            self._env = persipubsub.queue._initialize_environment(
+                queue_dir=self.path,
+                max_reader_num=persipubsub.database.DEFAULT_MAX_READERS,
+                max_db_num=persipubsub.database.DEFAULT_MAX_DB_NUM,
+                max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE,
+                durability=durability)
+
+        self.durability = durability
+        self._queue = None  # type: Optional[persipubsub.queue._Queue]
+        self._reattach_fns = []  # type: List[Callable[[], None]]
         self.closed = False
 
     def __enter__(self) -> 'Environment':
@@ -75,6 +108,71 @@ class Environment:
         self._env.close()
         self.closed = True
 
+    def _track(self, queue: 'persipubsub.queue._Queue') -> None:
+        """
+        Register the queue of a component for re-attachment.
+
+        After compact() swapped the data file and reopened the LMDB
+        environment, the registered queues are re-initialized against the
+        new environment so their components keep working.
+
+        :param queue: of the component to re-attach after a compaction
+        """
+        self._reattach_fns.append(
+            lambda: queue.init(path=self.path, env=self._env))
+
+    def _shared_queue(self) -> 'persipubsub.queue._Queue':
+        """
+        Resolve the queue shared by the components of this environment.
+
+        The queue is initialized once and handed to every component created
+        afterwards, so opening many components (or many queues at boot)
+        performs the database handshake only once per queue.
+
+        :return: initialized queue of this environment
+        """
+        if self._queue is None:
+            queue = persipubsub.queue._Queue()
+            queue.init(path=self.path, env=self._env)
+            self._track(queue=queue)
+            self._queue = queue
+        return self._queue
+
+    @icontract.require(lambda self: not self.closed)
+    def compact(self) -> None:
+        """
+        Compact the queue and re-attach the components of the environment.
+
+        A compacted snapshot is written beside the live environment and
+        atomically swapped in (see Control.compact), which restores dense
+        pages and reclaims the space which pruning freed. Afterwards the
+        LMDB environment is reopened on the compacted file and every
+        component created from this environment is re-attached, so active
+        publishers and subscribers continue without a restart.
+
+        Other processes attached to the queue keep the mapping of the old
+        file and must reopen their own environment before they write
+        again; schedule the compaction in a window in which this process
+        is the only one attached to the queue.
+        """
+        control = persipubsub.control.initialize(
+            path=self.path,
+            env=self._env,
+            durability=self.durability,
+            queue=self._queue)
+        control.compact()
+
+        self._env.close()
+        self._env = persipubsub.queue._initialize_environment(
+            queue_dir=self.path,
+            max_reader_num=persipubsub.database.DEFAULT_MAX_READERS,
+            max_db_num=persipubsub.database.DEFAULT_MAX_DB_NUM,
+            max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE,
+            durability=self.durability)
+
+        for reattach in self._reattach_fns:
+            reattach()
+
     @icontract.require(lambda self: not self.closed)
     def new_control(self,
                     subscriber_ids: Optional[Set[str]] = None,
@@ -91,43 +189,192 @@ class Environment:
         :return: Control to create and maintain queue
         """
         # pylint: disable=too-many-arguments
-        return persipubsub.control.initialize(
+        control = persipubsub.control.initialize(
             path=self.path,
             env=self._env,
             subscriber_ids=subscriber_ids,
             high_water_mark=high_water_mark,
-            strategy=strategy)
+            strategy=strategy,
+            durability=self.durability,
+            queue=self._queue)
+        assert control.queue is not None
+        if self._queue is None:
+            self._track(queue=control.queue)
+            self._queue = control.queue
+        return control
 
     @icontract.require(lambda self: not self.closed)
-    def new_publisher(
-            self, autosync: bool = False) -> persipubsub.publisher.Publisher:
+    def new_publisher(self,
+                      autosync: bool = False,
+                      cleanup_interval_msgs: int = persipubsub.queue.
+                      DEFAULT_CLEANUP_INTERVAL_MSGS,
+                      cleanup_interval_secs: int = persipubsub.queue.
+                      DEFAULT_CLEANUP_INTERVAL_SECS,
+                      group_commit: bool = False,
+                      group_commit_interval_secs: float = persipubsub.
+                      publisher.DEFAULT_GROUP_COMMIT_INTERVAL_SECS,
+                      group_commit_max_msgs: int = persipubsub.publisher.
+                      DEFAULT_GROUP_COMMIT_MAX_MSGS,
+                      max_batch_msgs: int = persipubsub.publisher.
+                      DEFAULT_MAX_BATCH_MSGS,
+                      max_batch_bytes: int = persipubsub.publisher.
+                      DEFAULT_MAX_BATCH_BYTES
+                      ) -> persipubsub.publisher.Publisher:
         """
         Create a new publisher.
 
         :param autosync: if True, store data automatically in LMDB
+        :param cleanup_interval_msgs:
+            number of messages after which cleanup runs at the latest
+        :param cleanup_interval_secs:
+            time after which cleanup runs at the latest (secs)
+        :param group_commit:
+            if True, sends from all threads are combined and committed in
+            batches instead of one write transaction per message
+        :param group_commit_interval_secs:
+            time for which a group commit waits for more messages (secs)
+        :param group_commit_max_msgs:
+            maximal number of messages committed in one group
+        :param max_batch_msgs:
+            maximal number of messages committed in one send_many chunk
+        :param max_batch_bytes:
+            maximal payload size committed in one send_many chunk (in bytes)
         :return: Publisher to send messages
         """
-        return persipubsub.publisher.initialize(
-            path=self.path, autosync=autosync, env=self._env)
+        # pylint: disable=too-many-arguments
+        publisher = persipubsub.publisher.initialize(
+            path=self.path,
+            autosync=autosync,
+            env=self._env,
+            cleanup_interval_msgs=cleanup_interval_msgs,
+            cleanup_interval_secs=cleanup_interval_secs,
+            group_commit=group_commit,
+            group_commit_interval_secs=group_commit_interval_secs,
+            group_commit_max_msgs=group_commit_max_msgs,
+            max_batch_msgs=max_batch_msgs,
+            max_batch_bytes=max_batch_bytes,
+            queue=self._shared_queue())
+        return publisher
 
     @icontract.require(lambda self: not self.closed)
     def new_subscriber(self,
-                       identifier: str) -> persipubsub.subscriber.Subscriber:
+                       identifier: str,
+                       deferred_ack: bool = False,
+                       ack_interval_msgs: int = persipubsub.subscriber.
+                       DEFAULT_ACK_INTERVAL_MSGS,
+                       ack_interval_secs: int = persipubsub.subscriber.
+                       DEFAULT_ACK_INTERVAL_SECS
+                       ) -> persipubsub.subscriber.Subscriber:
         """
         Create a new subscriber.
 
         :param identifier: of the subscriber
+        :param deferred_ack:
+            if True, received messages are acknowledged in memory and popped
+            in batches instead of one write transaction per message
+        :param ack_interval_msgs:
+            number of acknowledged messages after which acks are flushed at
+            the latest
+        :param ack_interval_secs:
+            time after which acknowledged messages are flushed at the latest
+            (secs)
         :return: Subscriber to receive messages
         """
-        return persipubsub.subscriber.initialize(
-            path=self.path, env=self._env, identifier=identifier)
+        subscriber = persipubsub.subscriber.initialize(
+            path=self.path,
+            env=self._env,
+            identifier=identifier,
+            deferred_ack=deferred_ack,
+            ack_interval_msgs=ack_interval_msgs,
+            ack_interval_secs=ack_interval_secs,
+            queue=self._shared_queue())
+        return subscriber
+
+    @icontract.require(lambda self: not self.closed)
+    def new_consumer(self,
+                     group_id: str,
+                     owner_id: str,
+                     lease_timeout: int = persipubsub.consumer.
+                     DEFAULT_LEASE_TIMEOUT) -> persipubsub.consumer.Consumer:
+        """
+        Create a new consumer of a consumer group.
+
+        :param group_id: of the consumer group which shares the stream
+        :param owner_id: of this consumer within the group
+        :param lease_timeout:
+            time after which an unacknowledged claim expires (secs)
+        :return: Consumer to claim and acknowledge messages
+        """
+        consumer = persipubsub.consumer.initialize(
+            path=self.path,
+            env=self._env,
+            group_id=group_id,
+            owner_id=owner_id,
+            lease_timeout=lease_timeout,
+            queue=self._shared_queue())
+
+        def reattach_lease_db() -> None:
+            """Re-resolve the lease database against the new environment."""
+            assert consumer.queue is not None
+            assert consumer.queue.env is not None
+            consumer._lease_db = consumer.queue.env.open_db(
+                key=persipubsub.database.lease_db_name(group_id=group_id),
+                create=True)
+
+        self._reattach_fns.append(reattach_lease_db)
+        return consumer
+
+    @icontract.require(lambda self: not self.closed)
+    def new_async_publisher(
+            self,
+            autosync: bool = False,
+            loop: Optional[asyncio.AbstractEventLoop] = None
+    ) -> persipubsub.async_publisher.AsyncPublisher:
+        """
+        Create a new async publisher.
+
+        :param autosync: if True, store data automatically in LMDB
+        :param loop: event loop; defaults to the current event loop
+        :return: AsyncPublisher to send messages from coroutines
+        """
+        async_publisher = persipubsub.async_publisher.initialize(
+            path=self.path,
+            autosync=autosync,
+            env=self._env,
+            loop=loop,
+            queue=self._shared_queue())
+        return async_publisher
+
+    @icontract.require(lambda self: not self.closed)
+    def new_async_subscriber(
+            self,
+            identifier: str,
+            loop: Optional[asyncio.AbstractEventLoop] = None
+    ) -> persipubsub.async_subscriber.AsyncSubscriber:
+        """
+        Create a new async subscriber.
+
+        :param identifier: of the subscriber
+        :param loop: event loop; defaults to the current event loop
+        :return: AsyncSubscriber to receive messages from coroutines
+        """
+        async_subscriber = persipubsub.async_subscriber.initialize(
+            path=self.path,
+            env=self._env,
+            identifier=identifier,
+            loop=loop,
+            queue=self._shared_queue())
+        return async_subscriber
 
 
-def initialize(path: pathlib.Path) -> Environment:
+def initialize(path: pathlib.Path,
+               durability: Optional[
+                   persipubsub.queue.Durability] = None) -> Environment:
     """
     Create a new environment.
 
     :param path: path to the queue
+    :param durability: trades crash durability against write throughput
     :return: Environment to create control, publisher and subscriber
     """
-    return Environment(path=path)
+    return Environment(path=path, durability=durability)
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Collect in-process metrics of queue operations at negligible cost."""
+
+import time
+from typing import Any, List, Mapping, MutableMapping  # pylint: disable=unused-import
+
+#: Number of power-of-two latency buckets; 2^40 ns is about 18 minutes.
+BUCKET_NUM = 40
+
+
+class Histogram:
+    """
+    Accumulate durations in power-of-two buckets.
+
+    Recording a duration costs an integer bit_length and three additions,
+    so operations on the hot path can be instrumented unconditionally.
+
+    :ivar count: number of recorded durations
+    :vartype count: int
+    :ivar sum_ns: sum of all recorded durations in nanoseconds
+    :vartype sum_ns: int
+    """
+
+    def __init__(self) -> None:
+        """Initialize."""
+        self.count = 0
+        self.sum_ns = 0
+        self.buckets = [0] * BUCKET_NUM  # type: List[int]
+
+    def record(self, duration: float) -> None:
+        """
+        Record one duration.
+
+        :param duration: of the operation in seconds
+        :return:
+        """
+        duration_ns = int(duration * 10**9)
+        self.count += 1
+        self.sum_ns += duration_ns
+        index = min(duration_ns.bit_length(), BUCKET_NUM - 1)
+        self.buckets[index] += 1
+
+    def snapshot(self) -> Mapping[str, Any]:
+        """
+        Copy the current state of the histogram.
+
+        The buckets map the upper bound in nanoseconds (2^index) to the
+        number of durations which fell below it, cumulatively as in
+        Prometheus histograms.
+
+        :return: count, sum in nanoseconds and cumulative buckets
+        """
+        cumulative = 0
+        buckets = {}  # type: MutableMapping[int, int]
+        for index, value in enumerate(self.buckets):
+            cumulative += value
+            if value > 0:
+                buckets[2**index] = cumulative
+
+        return {'count': self.count, 'sum_ns': self.sum_ns, 'buckets': buckets}
+
+
+class Metrics:
+    """
+    Hold the metrics of one queue within the current process.
+
+    The metrics are not shared between processes; every publisher,
+    subscriber or control accumulates the operations which it performed
+    itself.
+
+    :ivar latencies: per-operation latency histograms
+    :vartype latencies: MutableMapping[str, Histogram]
+    :ivar counters: per-event counters
+    :vartype counters: MutableMapping[str, int]
+    :ivar residencies: per-subscriber queue-residency histograms
+    :vartype residencies: MutableMapping[str, Histogram]
+    """
+
+    OPERATIONS = ['put', 'front', 'pop', 'cleanup', 'commit']
+
+    def __init__(self) -> None:
+        """Initialize."""
+        self.latencies = {
+            operation: Histogram()
+            for operation in self.OPERATIONS
+        }  # type: MutableMapping[str, Histogram]
+        self.counters = {
+            'msgs_put': 0,
+            'msgs_popped': 0,
+            'msgs_pruned': 0,
+            'prune_runs': 0,
+            'cleanup_runs': 0
+        }  # type: MutableMapping[str, int]
+        self.residencies = {}  # type: MutableMapping[str, Histogram]
+
+    def record(self, operation: str, start: float) -> None:
+        """
+        Record the latency of an operation which started at start.
+
+        :param operation: one of OPERATIONS
+        :param start: start of the operation, taken with time.perf_counter()
+        :return:
+        """
+        self.latencies[operation].record(
+            duration=time.perf_counter() - start)
+
+    def record_residency(self, sub_id: str, duration: float) -> None:
+        """
+        Record the queue-residency time of one sampled message.
+
+        :param sub_id: subscriber which received the message
+        :param duration: time between publish and receipt in seconds
+        :return:
+        """
+        histogram = self.residencies.get(sub_id, None)
+        if histogram is None:
+            histogram = Histogram()
+            self.residencies[sub_id] = histogram
+        histogram.record(duration=duration)
+
+    def count(self, counter: str, delta: int = 1) -> None:
+        """
+        Increase a counter.
+
+        :param counter: name of the counter
+        :param delta: by which the counter is increased
+        :return:
+        """
+        self.counters[counter] += delta
+
+    def snapshot(self) -> MutableMapping[str, Any]:
+        """
+        Copy the current state of all metrics.
+
+        :return: counters and per-operation latency histograms
+        """
+        return {
+            'counters': dict(self.counters),
+            'latencies': {
+                operation: histogram.snapshot()
+                for operation, histogram in self.latencies.items()
+            },
+            'residencies': {
+                sub_id: histogram.snapshot()
+                for sub_id, histogram in self.residencies.items()
+            }
+        }
+
+
+def format_prometheus(snapshot: Mapping[str, Any],
+                      prefix: str = 'persipubsub') -> str:
+    """
+    Format a metrics snapshot as Prometheus text exposition format.
+
+    :param snapshot: as returned by Metrics.snapshot() or Control.metrics()
+    :param prefix: prepended to every metric name
+    :return: snapshot in Prometheus text format
+    """
+    lines = []  # type: List[str]
+    for counter, value in sorted(snapshot['counters'].items()):
+        lines.append('{}_{}_total {}'.format(prefix, counter, value))
+
+    for operation, histogram in sorted(snapshot['latencies'].items()):
+        name = '{}_{}_latency_seconds'.format(prefix, operation)
+        for bound_ns, cumulative in sorted(histogram['buckets'].items()):
+            lines.append('{}_bucket{{le="{}"}} {}'.format(
+                name, bound_ns / 10**9, cumulative))
+        lines.append('{}_bucket{{le="+Inf"}} {}'.format(
+            name, histogram['count']))
+        lines.append('{}_sum {}'.format(name, histogram['sum_ns'] / 10**9))
+        lines.append('{}_count {}'.format(name, histogram['count']))
+
+    for sub_id, histogram in sorted(snapshot.get('residencies', {}).items()):
+        name = '{}_residency_seconds'.format(prefix)
+        for bound_ns, cumulative in sorted(histogram['buckets'].items()):
+            lines.append('{}_bucket{{subscriber="{}",le="{}"}} {}'.format(
+                name, sub_id, bound_ns / 10**9, cumulative))
+        lines.append('{}_bucket{{subscriber="{}",le="+Inf"}} {}'.format(
+            name, sub_id, histogram['count']))
+        lines.append('{}_sum{{subscriber="{}"}} {}'.format(
+            name, sub_id, histogram['sum_ns'] / 10**9))
+        lines.append('{}_count{{subscriber="{}"}} {}'.format(
+            name, sub_id, histogram['count']))
+
+    for gauge in ['num_msgs', 'data_size_bytes']:
+        if gauge in snapshot:
+            lines.append('{}_{} {}'.format(prefix, gauge, snapshot[gauge]))
+
+    return '\n'.join(lines) + '\n'
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Wake up subscribers as soon as a publisher commits a message."""
+
+import os
+import pathlib
+import select
+import time
+from typing import Iterable, Optional, Union
+
+#: Directory inside the queue directory which holds the notification FIFOs
+NOTIFICATION_DIR = ".notification"  # type: str
+
+
+def fifo_path(queue_dir: pathlib.Path, sub_id: str) -> pathlib.Path:
+    """
+    Resolve the path of the notification FIFO of a subscriber.
+
+    :param queue_dir: where the queue is stored
+    :param sub_id: Subscriber ID
+    :return: path to the named pipe of the subscriber
+    """
+    return queue_dir / NOTIFICATION_DIR / sub_id
+
+
+class Notifier:
+    """
+    Signal waiting subscribers that a message has been committed.
+
+    The notifier writes a single byte to the named pipe of every subscriber
+    which currently listens. Subscribers which do not listen are skipped, so
+    notifying is cheap and never blocks the publisher.
+
+    :ivar queue_dir: where the queue is stored
+    :vartype queue_dir: pathlib.Path
+    """
+
+    def __init__(self, queue_dir: Union[pathlib.Path, str]) -> None:
+        """
+        Initialize.
+
+        :param queue_dir: where the queue is stored
+        """
+        self.queue_dir = queue_dir if isinstance(queue_dir, pathlib.Path) \
+            else pathlib.Path(queue_dir)
+
+    def notify(self, sub_ids: Iterable[str]) -> None:
+        """
+        Wake up all listening subscribers.
+
+        :param sub_ids: subscribers which should be woken up
+        :return:
+        """
+        if not hasattr(os, 'mkfifo'):
+            # Named pipes are not available on this platform; subscribers
+            # fall back to polling.
+            return
+
+        for sub_id in sub_ids:
+            pth = fifo_path(queue_dir=self.queue_dir, sub_id=sub_id)
+            try:
+                # O_NONBLOCK makes the open fail with ENXIO when no
+                # subscriber has the pipe open for reading.
+                fd = os.open(pth.as_posix(), os.O_WRONLY | os.O_NONBLOCK)
+            except OSError:
+                continue
+
+            try:
+                os.write(fd, b'\x00')
+            except OSError:
+                pass
+            finally:
+                os.close(fd)
+
+
+class Listener:
+    """
+    Block on the notification FIFO until a publisher commits a message.
+
+    The listener is the reading end of the named pipe of one subscriber.
+    If named pipes are not available, :py:meth:`wait` degrades to a plain
+    sleep so that the subscriber keeps its polling behaviour.
+
+    :ivar queue_dir: where the queue is stored
+    :vartype queue_dir: pathlib.Path
+    :ivar sub_id: Subscriber ID
+    :vartype sub_id: str
+    """
+
+    def __init__(self, queue_dir: Union[pathlib.Path, str],
+                 sub_id: str) -> None:
+        """
+        Initialize and open the reading end of the FIFO.
+
+        :param queue_dir: where the queue is stored
+        :param sub_id: Subscriber ID
+        """
+        self.queue_dir = queue_dir if isinstance(queue_dir, pathlib.Path) \
+            else pathlib.Path(queue_dir)
+        self.sub_id = sub_id
+        self._fd = None  # type: Optional[int]
+
+        if not hasattr(os, 'mkfifo'):
+            return
+
+        pth = fifo_path(queue_dir=self.queue_dir, sub_id=self.sub_id)
+        pth.parent.mkdir(parents=True, exist_ok=True)
+        try:
+            os.mkfifo(pth.as_posix())
+        except FileExistsError:
+            pass
+
+        self._fd = os.open(pth.as_posix(), os.O_RDONLY | os.O_NONBLOCK)
+
+    def wait(self, timeout: float) -> bool:
+        """
+        Wait until a publisher notifies or the timeout expires.
+
+        :param timeout: maximal time to wait for a notification (secs)
+        :return: True if a notification arrived before the timeout
+        """
+        if self._fd is None:
+            time.sleep(timeout)
+            return False
+
+        readable, _, _ = select.select([self._fd], [], [], timeout)
+        if not readable:
+            return False
+
+        # Drain the pipe so that pending notifications do not cause
+        # spurious wake-ups on the next wait.
+        try:
+            while os.read(self._fd, 4096):
+                pass
+        except BlockingIOError:
+            pass
+
+        return True
+
+    def close(self) -> None:
+        """Close the reading end of the FIFO."""
+        if self._fd is not None:
+            os.close(self._fd)
+            self._fd = None
@@ -2,7 +2,10 @@
 """Publish messages to a queue and save them persistently."""
 
 import pathlib
-from typing import Any, List, Optional, Union
+import threading
+import time
+from typing import (Any, Dict, Iterable, Iterator, List, Optional, Tuple,
+                    Union)
 
 import icontract
 import lmdb
@@ -11,22 +14,188 @@ import persipubsub.queue
 
 # pylint: disable=protected-access
 
+#: Default time for which a group commit waits for more messages (secs)
+DEFAULT_GROUP_COMMIT_INTERVAL_SECS = 0.005  # type: float
+#: Default maximal number of messages committed in one group
+DEFAULT_GROUP_COMMIT_MAX_MSGS = 256  # type: int
+#: Default maximal number of messages committed in one send_many chunk
+DEFAULT_MAX_BATCH_MSGS = 1024  # type: int
+#: Default maximal payload size committed in one send_many chunk (in bytes)
+DEFAULT_MAX_BATCH_BYTES = 64 * 1024**2  # type: int
 
-def initialize(path: pathlib.Path, autosync: bool,
-               env: lmdb.Environment) -> 'Publisher':
+
+def initialize(path: pathlib.Path,
+               autosync: bool,
+               env: lmdb.Environment,
+               cleanup_interval_msgs: int = persipubsub.queue.
+               DEFAULT_CLEANUP_INTERVAL_MSGS,
+               cleanup_interval_secs: int = persipubsub.queue.
+               DEFAULT_CLEANUP_INTERVAL_SECS,
+               group_commit: bool = False,
+               group_commit_interval_secs:
+               float = DEFAULT_GROUP_COMMIT_INTERVAL_SECS,
+               group_commit_max_msgs: int = DEFAULT_GROUP_COMMIT_MAX_MSGS,
+               max_batch_msgs: int = DEFAULT_MAX_BATCH_MSGS,
+               max_batch_bytes: int = DEFAULT_MAX_BATCH_BYTES,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'Publisher':
     """
     Initialize a new publisher.
 
     :param path: to LMDB
     :param autosync: if True, store data automatically in LMDB
     :param env: open LMDB environment
+    :param cleanup_interval_msgs:
+        number of messages after which cleanup runs at the latest
+    :param cleanup_interval_secs:
+        time after which cleanup runs at the latest (secs)
+    :param group_commit:
+        if True, sends from all threads are combined and committed in
+        batches instead of one write transaction per message
+    :param group_commit_interval_secs:
+        time for which a group commit waits for more messages (secs)
+    :param group_commit_max_msgs:
+        maximal number of messages committed in one group
+    :param max_batch_msgs:
+        maximal number of messages committed in one send_many chunk
+    :param max_batch_bytes:
+        maximal payload size committed in one send_many chunk (in bytes)
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        publisher initializes its own queue
     :return: Publisher to send messages
     """
+    # pylint: disable=too-many-arguments
     publisher = Publisher()
-    publisher.init(path=path, autosync=autosync, env=env)
+    publisher.init(
+        path=path,
+        autosync=autosync,
+        env=env,
+        cleanup_interval_msgs=cleanup_interval_msgs,
+        cleanup_interval_secs=cleanup_interval_secs,
+        group_commit=group_commit,
+        group_commit_interval_secs=group_commit_interval_secs,
+        group_commit_max_msgs=group_commit_max_msgs,
+        max_batch_msgs=max_batch_msgs,
+        max_batch_bytes=max_batch_bytes,
+        queue=queue)
     return publisher
 
 
+class _WriteCombiner:
+    """
+    Combine sends from all threads into group commits.
+
+    Messages are buffered in memory and flushed by a combiner thread
+    through one write transaction per batch, so the transaction commit and
+    its fsync are amortized over the whole batch. LMDB serializes writers
+    anyway; combining the writes trades a few milliseconds of latency for
+    a large gain in throughput.
+    """
+
+    def __init__(self, queue: 'persipubsub.queue._Queue',
+                 interval_secs: float, max_msgs: int) -> None:
+        """
+        Initialize and start the combiner thread.
+
+        :param queue: on which the batches are committed
+        :param interval_secs: time for which a flush waits for more messages
+        :param max_msgs: maximal number of messages committed in one batch
+        """
+        self._queue = queue
+        self._interval_secs = interval_secs
+        self._max_msgs = max_msgs
+        self._lock = threading.Lock()
+        self._msg_available = threading.Condition(self._lock)
+        self._batch_flushed = threading.Condition(self._lock)
+        self._pending = []  # type: List[Tuple[Optional[str], bytes]]
+        self._enqueued_num = 0
+        self._flushed_num = 0
+        self._error = None  # type: Optional[BaseException]
+        self._closing = False
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def enqueue(self,
+                msgs: List[bytes],
+                topic: Optional[str] = None,
+                wait: bool = True) -> None:
+        """
+        Add messages to the next batch.
+
+        :param msgs: messages in bytes
+        :param topic: of the messages; None reaches every subscriber
+        :param wait: if True, block until the batch is committed
+        :return:
+        """
+        with self._lock:
+            if self._error is not None:
+                raise RuntimeError(
+                    "The write combiner failed") from self._error
+
+            self._pending.extend((topic, msg) for msg in msgs)
+            self._enqueued_num += len(msgs)
+            ticket = self._enqueued_num
+            self._msg_available.notify()
+
+            if not wait:
+                return
+
+            while self._flushed_num < ticket and self._error is None:
+                self._batch_flushed.wait()
+
+            if self._error is not None and self._flushed_num < ticket:
+                raise RuntimeError(
+                    "The write combiner failed") from self._error
+
+    def close(self) -> None:
+        """Flush the remaining messages and stop the combiner thread."""
+        with self._lock:
+            self._closing = True
+            self._msg_available.notify()
+        self._thread.join()
+
+    def _run(self) -> None:
+        """Flush accumulated batches until closed."""
+        while True:
+            with self._lock:
+                while not self._pending and not self._closing:
+                    self._msg_available.wait()
+
+                if not self._pending:
+                    return
+
+                closing = self._closing
+
+            if not closing:
+                # Linger so that concurrent senders can join the batch.
+                time.sleep(self._interval_secs)
+
+            with self._lock:
+                batch = self._pending[:self._max_msgs]
+                del self._pending[:len(batch)]
+
+            try:
+                # One transaction per topic in the batch; batches without
+                # topics still commit in a single transaction.
+                by_topic = \
+                    {}  # type: Dict[Optional[str], List[bytes]]
+                for topic, msg in batch:
+                    by_topic.setdefault(topic, []).append(msg)
+                for topic, topic_msgs in by_topic.items():
+                    self._queue.put_many_flush_once(
+                        msgs=topic_msgs, topic=topic)
+            except BaseException as error:  # pylint: disable=broad-except
+                with self._lock:
+                    self._error = error
+                    self._batch_flushed.notify_all()
+                return
+
+            with self._lock:
+                self._flushed_num += len(batch)
+                self._batch_flushed.notify_all()
+
+
 class Publisher:
     """
     Handle publishing messages to the queue.
@@ -35,28 +204,84 @@ class Publisher:
     :vartype queue: persipubsub.queue.Queue
     :ivar autosync: sync after each message or after multiple messages
     :vartype autosync: bool
+    :ivar group_commit: combine sends from all threads into group commits
+    :vartype group_commit: bool
+    :ivar max_batch_msgs:
+        maximal number of messages committed in one send_many chunk
+    :vartype max_batch_msgs: int
+    :ivar max_batch_bytes:
+        maximal payload size committed in one send_many chunk (in bytes)
+    :vartype max_batch_bytes: int
     """
 
     def __init__(self) -> None:
         """Initialize class object."""
         self.queue = None  # type: Optional[persipubsub.queue._Queue]
         self.autosync = None  # type: Optional[bool]
+        self.group_commit = False
+        self.max_batch_msgs = DEFAULT_MAX_BATCH_MSGS  # type: int
+        self.max_batch_bytes = DEFAULT_MAX_BATCH_BYTES  # type: int
+        self._combiner = None  # type: Optional[_WriteCombiner]
         self.closed = False
 
     def init(self,
              path: Union[pathlib.Path, str],
              env: Optional[lmdb.Environment] = None,
-             autosync: bool = False) -> None:
+             autosync: bool = False,
+             cleanup_interval_msgs: int = persipubsub.queue.
+             DEFAULT_CLEANUP_INTERVAL_MSGS,
+             cleanup_interval_secs: int = persipubsub.queue.
+             DEFAULT_CLEANUP_INTERVAL_SECS,
+             group_commit: bool = False,
+             group_commit_interval_secs:
+             float = DEFAULT_GROUP_COMMIT_INTERVAL_SECS,
+             group_commit_max_msgs: int = DEFAULT_GROUP_COMMIT_MAX_MSGS,
+             max_batch_msgs: int = DEFAULT_MAX_BATCH_MSGS,
+             max_batch_bytes: int = DEFAULT_MAX_BATCH_BYTES,
+             queue: Optional['persipubsub.queue._Queue'] = None
+             ) -> None:
         """
         Initialize.
 
         :param path: path to the queue
         :param env: open LMDBenvironment
         :param autosync: if True, store data automatically in LMDB
+        :param cleanup_interval_msgs:
+            number of messages after which cleanup runs at the latest
+        :param cleanup_interval_secs:
+            time after which cleanup runs at the latest (secs)
+        :param group_commit:
+            if True, sends from all threads are combined and committed in
+            batches instead of one write transaction per message
+        :param group_commit_interval_secs:
+            time for which a group commit waits for more messages (secs)
+        :param group_commit_max_msgs:
+            maximal number of messages committed in one group
+        :param max_batch_msgs:
+            maximal number of messages committed in one send_many chunk
+        :param max_batch_bytes:
+            maximal payload size committed in one send_many chunk (in bytes)
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the publisher initializes its own queue
         """
-        self.queue = persipubsub.queue._Queue()  # pylint: disable=protected-access
-        self.queue.init(path=path, env=env)
+        # pylint: disable=too-many-arguments
+        if queue is not None:
+            self.queue = queue
+        else:
+            self.queue = persipubsub.queue._Queue()  # pylint: disable=protected-access
+            self.queue.init(path=path, env=env)
+        self.queue.cleanup_interval_msgs = cleanup_interval_msgs
+        self.queue.cleanup_interval_secs = cleanup_interval_secs
         self.autosync = autosync
+        self.group_commit = group_commit
+        self.max_batch_msgs = max_batch_msgs
+        self.max_batch_bytes = max_batch_bytes
+        if group_commit:
+            self._combiner = _WriteCombiner(
+                queue=self.queue,
+                interval_secs=group_commit_interval_secs,
+                max_msgs=group_commit_max_msgs)
 
     def __enter__(self) -> 'Publisher':
         """Enter the context and give the pub prepared in the constructor."""
@@ -67,29 +292,123 @@ class Publisher:
         self.close()
 
     def close(self) -> None:
-        """Close publisher."""
+        """Close publisher after flushing any buffered group commits."""
+        if self._combiner is not None:
+            self._combiner.close()
+            self._combiner = None
         self.closed = True
 
     @icontract.require(lambda self: not self.closed)
-    def send(self, msg: bytes) -> None:
+    def send(self,
+             msg: bytes,
+             topic: Optional[str] = None,
+             wait: bool = True) -> None:
         """
         Write one message to queue in one transaction.
 
+        With group commit enabled the message is handed to the combiner
+        thread and committed together with the sends of other threads.
+
         :param msg: to queue that all subscribers can read it
+        :param topic:
+            of the message; reaches only the subscribers whose subscription
+            matches, None reaches every subscriber
+        :param wait:
+            only relevant with group commit; if True, block until the batch
+            which contains the message is committed
         """
         assert self.queue is not None
-        self.queue.put(msg=msg)
+        if self._combiner is not None:
+            self._combiner.enqueue(msgs=[msg], topic=topic, wait=wait)
+        else:
+            self.queue.put(msg=msg, topic=topic)
 
-    @icontract.require(lambda self: not self.closed)
-    def send_many(self, msgs: List[bytes]) -> None:
+    def _chunks(self, msgs: Iterable[bytes]) -> Iterator[List[bytes]]:
         """
-        Write multiple messages to queue in one transaction.
+        Chunk the messages so that each chunk stays within the batch limits.
 
         :param msgs: to queue that all subscribers can read them
+        :return: Iterator over chunks of messages
+        """
+        chunk = []  # type: List[bytes]
+        chunk_bytes = 0
+        for msg in msgs:
+            chunk.append(msg)
+            chunk_bytes += len(msg)
+            if len(chunk) >= self.max_batch_msgs \
+                    or chunk_bytes >= self.max_batch_bytes:
+                yield chunk
+                chunk = []
+                chunk_bytes = 0
+
+        if chunk:
+            yield chunk
+
+    def _commit_chunk(self,
+                      chunk: List[bytes],
+                      topic: Optional[str] = None,
+                      wait: bool = True) -> None:
+        """
+        Commit one chunk of messages to the queue.
+
+        :param chunk: messages committed together
+        :param topic: of all messages; None reaches every subscriber
+        :param wait:
+            only relevant with group commit; if True, block until the batch
+            which contains the messages is committed
         """
         assert self.queue is not None
-        if self.autosync:
-            for msg in msgs:
-                self.queue.put(msg=msg)
+        if self._combiner is not None:
+            self._combiner.enqueue(msgs=chunk, topic=topic, wait=wait)
+        elif self.autosync:
+            for msg in chunk:
+                self.queue.put(msg=msg, topic=topic)
         else:
-            self.queue.put_many_flush_once(msgs=msgs)
+            self.queue.put_many_flush_once(msgs=chunk, topic=topic)
+
+    @icontract.require(lambda self: not self.closed)
+    def send_many(self,
+                  msgs: Iterable[bytes],
+                  topic: Optional[str] = None,
+                  wait: bool = True) -> None:
+        """
+        Stream multiple messages to the queue in chunked transactions.
+
+        The messages are consumed lazily from the iterable and committed
+        whenever the accumulated chunk reaches max_batch_msgs messages or
+        max_batch_bytes bytes, so arbitrarily large message streams are
+        published with constant memory and bounded write transactions.
+
+        :param msgs: to queue that all subscribers can read them
+        :param topic:
+            of all messages; reaches only the subscribers whose subscription
+            matches, None reaches every subscriber
+        :param wait:
+            only relevant with group commit; if True, block until the batch
+            which contains the messages is committed
+        """
+        for chunk in self._chunks(msgs=msgs):
+            self._commit_chunk(chunk=chunk, topic=topic, wait=wait)
+
+    @icontract.require(lambda self: not self.closed)
+    def send_stream(self,
+                    msgs: Iterable[bytes],
+                    topic: Optional[str] = None) -> Iterator[int]:
+        """
+        Stream messages like send_many, but yield progress after each chunk.
+
+        After each committed chunk the running number of sent messages is
+        yielded, so the caller can checkpoint the stream and resume from the
+        last yielded count after a crash.
+
+        :param msgs: to queue that all subscribers can read them
+        :param topic:
+            of all messages; reaches only the subscribers whose subscription
+            matches, None reaches every subscriber
+        :return: Iterator over the running number of committed messages
+        """
+        sent_num = 0
+        for chunk in self._chunks(msgs=msgs):
+            self._commit_chunk(chunk=chunk, topic=topic, wait=True)
+            sent_num += len(chunk)
+            yield sent_num
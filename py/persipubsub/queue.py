@@ -1,16 +1,25 @@
 #!/usr/bin/env python3
 """Store messages in a local LMDB."""
+import contextlib
 import datetime
 import enum
+import fnmatch
+import lzma
+import mmap
 import pathlib
-import uuid
-from typing import Any, Dict, List, Optional, Set, Tuple, Union
+import shutil
+import threading
+import time
+import zlib
+from typing import Any, Dict, Iterator, List, Optional, Set, Tuple, Union
 
 import icontract
 import lmdb
 
 import persipubsub
 import persipubsub.database
+import persipubsub.metrics
+import persipubsub.notification
 
 #: Default message timeout (secs)
 DEFAULT_MESSAGE_TIMEOUT = 500  # type: int
@@ -18,6 +27,10 @@ DEFAULT_MESSAGE_TIMEOUT = 500  # type: int
 DEFAULT_MAX_MESSAGES = 1024 * 64
 #: Default high water mark LMDB size (in bytes)
 DEFAULT_HWM_DB_SIZE = 30 * 1024**3  # type: int
+#: Default number of messages after which cleanup runs at the latest
+DEFAULT_CLEANUP_INTERVAL_MSGS = 1  # type: int
+#: Default time after which cleanup runs at the latest (secs)
+DEFAULT_CLEANUP_INTERVAL_SECS = 0  # type: int
 
 
 class Strategy(enum.Enum):
@@ -43,6 +56,132 @@ def _parse_strategy(identifier: str) -> Strategy:
     raise ValueError("Unknown strategy: '{}' choosen.".format(identifier))
 
 
+#: Codecs available for transparent payload compression. zlib favors
+#: latency-sensitive queues, lzma compresses cold queues tighter.
+COMPRESSION_CODECS = {
+    'zlib': (zlib.compress, zlib.decompress),
+    'lzma': (lzma.compress, lzma.decompress)
+}
+
+
+def _compress(codec: str, msg: bytes) -> bytes:
+    """
+    Compress a payload and prepend the compression marker and codec.
+
+    :param codec: one of COMPRESSION_CODECS
+    :param msg: message in bytes
+    :return: marked and compressed payload
+    """
+    compress, _ = COMPRESSION_CODECS[codec]
+    return persipubsub.database.COMPRESSION_MARKER + \
+        persipubsub.database.str_to_bytes(codec) + b'\x00' + compress(msg)
+
+
+def _maybe_decompress(value: bytes) -> bytes:
+    """
+    Reverse the compression of a data value if it carries the marker.
+
+    Uncompressed legacy values are returned unchanged.
+
+    :param value: data value as stored in the data database
+    :return: original payload
+    """
+    marker = persipubsub.database.COMPRESSION_MARKER
+    if not value[:len(marker)] == marker:
+        return value
+
+    codec_end = value.index(b'\x00', len(marker))
+    codec = persipubsub.database.bytes_to_str(value[len(marker):codec_end])
+    _, decompress = COMPRESSION_CODECS[codec]
+    return decompress(value[codec_end + 1:])
+
+
+def _topic_matches(pattern: Optional[str], topic: Optional[str]) -> bool:
+    """
+    Check whether a subscription pattern matches the topic of a message.
+
+    A subscriber without a pattern receives every message and a message
+    without a topic reaches every subscriber, so queues which do not use
+    topics behave as before.
+
+    :param pattern: fnmatch-style subscription pattern of the subscriber
+    :param topic: of the message
+    :return: True when the message should reach the subscriber
+    """
+    if pattern is None or topic is None:
+        return True
+
+    return fnmatch.fnmatchcase(topic, pattern)
+
+
+class Durability(enum.Enum):
+    """Hold possible durability profiles."""
+
+    STRICT = 0
+    RELAXED = 1
+    VOLATILE = 2
+
+
+def _parse_durability(identifier: str) -> Durability:
+    """
+    Parse durability profile.
+
+    :param identifier: Durability profile stored in LMDB
+    :return: set durability profile
+    """
+    if Durability.STRICT.name == identifier:
+        return Durability.STRICT
+
+    if Durability.RELAXED.name == identifier:
+        return Durability.RELAXED
+
+    if Durability.VOLATILE.name == identifier:
+        return Durability.VOLATILE
+
+    raise ValueError(
+        "Unknown durability profile: '{}' choosen.".format(identifier))
+
+
+def _durability_flags(durability: Durability) -> Dict[str, bool]:
+    """
+    Map a durability profile to the LMDB environment flags.
+
+    | STRICT flushes data and meta page synchronously on every commit and
+    | survives a system crash.
+    | RELAXED uses a writeable memory map and skips the meta page flush;
+    | at most the last committed transaction is lost on a system crash.
+    | VOLATILE flushes asynchronously only; the queue stays consistent
+    | after an application crash but arbitrarily many of the last
+    | transactions may be lost on a system crash.
+
+    :param durability: profile chosen for the queue
+    :return: keyword arguments for lmdb.open
+    """
+    if durability == Durability.STRICT:
+        return {
+            'sync': True,
+            'metasync': True,
+            'writemap': False,
+            'map_async': False
+        }
+
+    if durability == Durability.RELAXED:
+        return {
+            'sync': True,
+            'metasync': False,
+            'writemap': True,
+            'map_async': False
+        }
+
+    assert durability == Durability.VOLATILE
+    return {
+        'sync': False,
+        'metasync': False,
+        'writemap': True,
+        'map_async': True
+    }
+
+
 class HighWaterMark:
     """Hold high water mark limits."""
 
@@ -71,7 +210,8 @@ def _initialize_environment(
         queue_dir: pathlib.Path,
         max_reader_num: int = 1024,
         max_db_num: int = 1024,
-        max_db_size_bytes: int = 32 * 1024**3) -> lmdb.Environment:
+        max_db_size_bytes: int = 32 * 1024**3,
+        durability: Durability = Durability.STRICT) -> lmdb.Environment:
     """
     Initialize the queue; the queue directory is assumed to exist.
 
@@ -96,6 +236,7 @@ def _initialize_environment(
     :param max_reader_num: maximal number of readers
     :param max_db_num: maximal number of databases
     :param max_db_size_bytes: maximal size of database (in bytes)
+    :param durability: trades crash durability against write throughput
     :return: Load or if needed create LMDB from directory
     """
     if not queue_dir.exists():
@@ -107,10 +248,82 @@ def _initialize_environment(
         map_size=max_db_size_bytes,
         subdir=True,
         max_readers=max_reader_num,
-        max_dbs=max_db_num)
+        max_dbs=max_db_num,
+        **_durability_flags(durability=durability))
     return env
 
 
+def _add_to_counter(txn: lmdb.Transaction, queue_db: Any, key: bytes,
+                    delta: int) -> None:
+    """
+    Add a delta to a persistent counter stored in the queue database.
+
+    A missing counter counts as zero and the counter never drops below
+    zero, so queues written before the counters existed stay consistent.
+
+    :param txn: open write transaction
+    :param queue_db: handle to the queue database
+    :param key: under which the counter is stored
+    :param delta: by which the counter is changed
+    """
+    value = txn.get(key=key, db=queue_db)
+    current = 0 if value is None else persipubsub.database.bytes_to_int(value)
+    txn.put(
+        key=key,
+        value=persipubsub.database.int_to_bytes(max(0, current + delta)),
+        db=queue_db)
+
+
+def _generate_msg_id(txn: lmdb.Transaction, meta_db: Any) -> bytes:
+    """
+    Generate a compact monotonic message ID.
+
+    The ID is the current UTC timestamp in nanoseconds encoded as 8 bytes
+    (see :py:mod:`persipubsub.database` for the encoding). Monotonicity is
+    guaranteed by bumping the ID right past the last key of the meta
+    database; since the caller holds the write transaction, no other
+    publisher can interleave. Monotonic keys always sort last, so all
+    message writes can use LMDB's append mode which fills pages densely
+    instead of splitting them.
+
+    :param txn: open write transaction
+    :param meta_db: handle to the meta database
+    :return: message ID as 8 bytes
+    """
+    msg_id = int(datetime.datetime.utcnow().timestamp() * 10**9)
+
+    cursor = txn.cursor(db=meta_db)
+    if cursor.last():
+        last_key = cursor.key()
+        # Keys of the old string format are longer than 8 bytes and are
+        # not numeric; they always sort above the 8-byte IDs, so they
+        # neither collide with a new ID nor serve as a bump base.
+        if len(last_key) == persipubsub.database.BYTES_LENGTH:
+            last_msg_id = persipubsub.database.bytes_to_int(last_key)
+            if msg_id <= last_msg_id:
+                msg_id = last_msg_id + 1
+
+    return persipubsub.database.int_to_bytes(msg_id)
+
+
+def _delete_acks_for(txn: lmdb.Transaction, ack_db: Any,
+                     msg_id: bytes) -> None:
+    """
+    Delete all ack marks of a message.
+
+    :param txn: open write transaction
+    :param ack_db: handle to the ack database
+    :param msg_id: message ID as 8 bytes
+    """
+    cursor = txn.cursor(db=ack_db)
+    if not cursor.set_range(msg_id):
+        return
+
+    while bytes(cursor.key()[:len(msg_id)]) == msg_id:
+        if not cursor.delete():
+            break
+
+
 def _prune_dangling_messages_for(queue: '_Queue',
                                  subscriber_ids: Set[str]) -> None:
     """
@@ -120,33 +333,71 @@ def _prune_dangling_messages_for(queue: '_Queue',
     :param subscriber_ids: subscribers of which dangling msgs should be pruned
     """
     assert queue.env is not None
-    with queue.env.begin(write=True) as txn:
-        pending_db = queue.env.open_db(
-            key=persipubsub.database.PENDING_DB, txn=txn, create=False)
-        meta_db = queue.env.open_db(
-            key=persipubsub.database.META_DB, txn=txn, create=False)
-        data_db = queue.env.open_db(
-            key=persipubsub.database.DATA_DB, txn=txn, create=False)
 
     # Definition of dangling messages:
     #   - having no pending subscribers
     #   - exists longer than timeout allows
 
+    # The zero-pending index only holds the messages which had no
+    # receivers at put time; messages which became fully consumed since
+    # are found through their ack marks below, so neither case requires
+    # scanning the whole pending database.
     msgs_to_delete = set()  # type: Set[bytes]
-    with queue.env.begin(db=pending_db) as txn:
+    with queue.env.begin(db=queue.zero_pending_db) as txn:
         cursor = txn.cursor()
-        cursor.first()
-        for key, pending_subscribers_num in cursor:
-            if persipubsub.database.bytes_to_int(pending_subscribers_num) == 0:
+        if cursor.first():
+            for key in cursor.iternext(keys=True, values=False):
                 msgs_to_delete.add(key)
 
+    # Acknowledgments are blind per-subscriber writes; whether a message is
+    # fully consumed is evaluated lazily here by counting its ack marks
+    # against the receiver count recorded at put time. The ack database
+    # only holds acks of messages which were not pruned yet, so the pass
+    # does not grow with the queue depth.
+    with queue.env.begin() as txn:
+        acks_per_msg = {}  # type: Dict[bytes, int]
+        ack_cursor = txn.cursor(db=queue.ack_db)
+        if ack_cursor.first():
+            for composite_key in ack_cursor.iternext(
+                    keys=True, values=False):
+                msg_id = composite_key[:persipubsub.database.BYTES_LENGTH]
+                acks_per_msg[msg_id] = acks_per_msg.get(msg_id, 0) + 1
+
+        for msg_id, ack_num in acks_per_msg.items():
+            receiver_value = txn.get(key=msg_id, db=queue.pending_db)
+            if receiver_value is None:
+                continue
+
+            if ack_num >= persipubsub.database.bytes_to_int(receiver_value):
+                msgs_to_delete.add(msg_id)
+
+    # Messages which a cursor subscriber did not consume yet are not
+    # dangling even when no key-copy subscriber is pending anymore.
+    if queue.cursor_subscriber_ids:
+        with queue.env.begin(write=False) as txn:
+            positions = [
+                txn.get(
+                    key=persipubsub.database.str_to_bytes(sub_id),
+                    db=queue.cursor_db)
+                for sub_id in queue.cursor_subscriber_ids
+            ]
+
+        if any(position is None for position in positions):
+            msgs_to_delete = set()
+        else:
+            min_position = min(positions)
+            msgs_to_delete = {
+                key
+                for key in msgs_to_delete if key <= min_position
+            }
+
     # Some subscriber might still await these messages in their own queue after
     # the high water mark timeout of the database.
     # That means that these messages also need to be removed from all
     # subscribers queues.
     msgs_to_delete_timeout = set()  # type: Set[bytes]
     assert queue.hwm is not None
-    with queue.env.begin(db=meta_db) as txn:
+    with queue.env.begin(db=queue.meta_db) as txn:
         cursor = txn.cursor()
 
         timestamp_now = datetime.datetime.utcnow().timestamp()
@@ -154,22 +405,49 @@ def _prune_dangling_messages_for(queue: '_Queue',
             if int(timestamp_now) - persipubsub.database.bytes_to_int(
                     timestamp) > queue.hwm.message_timeout:
                 msgs_to_delete_timeout.add(key)
+            else:
+                # The message IDs are monotonic timestamps, so the entries
+                # are stored in insert order and the scan can stop at the
+                # first message which did not expire yet.
+                break
 
     msgs_to_delete = msgs_to_delete.union(msgs_to_delete_timeout)
     with queue.env.begin(write=True) as txn:
+        deleted_num = 0
+        deleted_size_bytes = 0
         for key in msgs_to_delete:
-            txn.delete(key=key, db=pending_db)
-            txn.delete(key=key, db=meta_db)
-            txn.delete(key=key, db=data_db)
+            data_value = queue._get_data(txn=txn, key=key)
+            if data_value is not None:
+                deleted_num += 1
+                deleted_size_bytes += len(data_value)
+
+            txn.delete(key=key, db=queue.pending_db)
+            txn.delete(key=key, db=queue.zero_pending_db)
+            _delete_acks_for(txn=txn, ack_db=queue.ack_db, msg_id=key)
+            txn.delete(key=key, db=queue.meta_db)
+
+            seg_db = queue.data_db_for(msg_id=key, create=False)
+            if seg_db is not None:
+                txn.delete(key=key, db=seg_db)
+            txn.delete(key=key, db=queue.data_db)
+            queue._delete_blob(msg_id=key)
 
         for sub_id in subscriber_ids:
-            sub_db = queue.env.open_db(
-                key=persipubsub.database.str_to_bytes(sub_id),
-                txn=txn,
-                create=False)
+            sub_db = queue.sub_db(sub_id=sub_id)
             for key in msgs_to_delete_timeout:
                 txn.delete(key=key, db=sub_db)
 
+        _add_to_counter(
+            txn=txn,
+            queue_db=queue.queue_db,
+            key=persipubsub.database.NUM_MSGS_KEY,
+            delta=-deleted_num)
+        _add_to_counter(
+            txn=txn,
+            queue_db=queue.queue_db,
+            key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+            delta=-deleted_size_bytes)
+
 
 class _Queue:
     """
@@ -190,6 +468,42 @@ class _Queue:
     :vartype strategy: Strategy
     :ivar subscriber_ids: all subscribers of the queue
     :vartype subscriber_ids: Set[str]
+    :ivar subscriber_topics:
+        topic pattern per subscriber; None matches every message
+    :vartype subscriber_topics: Dict[str, Optional[str]]
+    :ivar cursor_subscriber_ids:
+        subscribers whose state is a single cursor position instead of a
+        copy of every pending message key
+    :vartype cursor_subscriber_ids: Set[str]
+    :ivar notifier: wakes up listening subscribers after a commit
+    :vartype notifier: persipubsub.notification.Notifier
+    :ivar data_db: cached handle to the data database
+    :ivar pending_db: cached handle to the pending database
+    :ivar meta_db: cached handle to the meta database
+    :ivar queue_db: cached handle to the queue database
+    :ivar subscriber_db: cached handle to the subscriber database
+    :ivar sub_dbs: cached handles to the subscriber databases
+    :vartype sub_dbs: Dict[str, Any]
+    :ivar cleanup_interval_msgs:
+        number of published messages after which cleanup runs at the latest
+    :vartype cleanup_interval_msgs: int
+    :ivar cleanup_interval_secs:
+        time after which cleanup runs at the latest (secs)
+    :vartype cleanup_interval_secs: int
+    :ivar metrics: in-process metrics of the queue operations
+    :vartype metrics: persipubsub.metrics.Metrics
+    :ivar blob_threshold:
+        payloads of at least this size are stored as sidecar blob files;
+        None keeps all payloads inline
+    :vartype blob_threshold: Optional[int]
+    :ivar compression:
+        codec with which inline payloads are compressed; None stores the
+        payloads verbatim
+    :vartype compression: Optional[str]
+    :ivar residency_sample_interval:
+        one in this many received messages is sampled for queue-residency
+        tracing; 0 turns the sampling off
+    :vartype residency_sample_interval: int
     """
 
     def __init__(self) -> None:
@@ -199,6 +513,41 @@ class _Queue:
         self.hwm = None  # type: Optional[HighWaterMark]
         self.strategy = None  # type: Optional[Strategy]
         self.subscriber_ids = None  # type: Optional[Set[str]]
+        self.subscriber_topics = {}  # type: Dict[str, Optional[str]]
+        self.cursor_subscriber_ids = set()  # type: Set[str]
+        self.notifier = None  # type: Optional[persipubsub.notification.Notifier]
+        self.data_db = None  # type: Any
+        self.pending_db = None  # type: Any
+        self.meta_db = None  # type: Any
+        self.queue_db = None  # type: Any
+        self.subscriber_db = None  # type: Any
+        self.cursor_db = None  # type: Any
+        self.zero_pending_db = None  # type: Any
+        self.ack_db = None  # type: Any
+        self.sub_dbs = {}  # type: Dict[str, Any]
+        self._segment_dbs = {}  # type: Dict[int, Any]
+        self.blob_threshold = None  # type: Optional[int]
+        self.compression = None  # type: Optional[str]
+        self._config_epoch = None  # type: Optional[bytes]
+        self.residency_sample_interval = 0  # type: int
+        self._residency_sample_counter = 0  # type: int
+        # False while keys of the old string format remain in the queue;
+        # they sort above the 8-byte IDs, so LMDB would silently refuse
+        # append-mode writes of new messages.
+        self._append_writes = True  # type: bool
+        self.cleanup_interval_msgs = \
+            DEFAULT_CLEANUP_INTERVAL_MSGS  # type: int
+        self.cleanup_interval_secs = \
+            DEFAULT_CLEANUP_INTERVAL_SECS  # type: int
+        self._msgs_since_cleanup = 0  # type: int
+        # The never-cleaned state counts as recent so that the first put
+        # does not trip the seconds condition regardless of the configured
+        # interval.
+        self._last_cleanup_timestamp = \
+            datetime.datetime.utcnow().timestamp()  # type: float
+        # Holds per-thread state of the empty-poll fast path of front().
+        self._thread_local = threading.local()
+        self.metrics = persipubsub.metrics.Metrics()
         self.closed = False
 
     def __enter__(self) -> '_Queue':
@@ -237,17 +586,114 @@ class _Queue:
                 max_db_num=persipubsub.database.DEFAULT_MAX_DB_NUM,
                 max_db_size_bytes=persipubsub.database.DEFAULT_MAX_DB_SIZE)
 
-        with self.env.begin(write=True) as txn:
-            _ = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=True)
-            _ = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=True)
-            _ = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=True)
-            _ = self.env.open_db(
-                key=persipubsub.database.QUEUE_DB, txn=txn, create=True)
-            _ = self.env.open_db(
-                key=persipubsub.database.SUBSCRIBER_DB, txn=txn, create=True)
+        # Cached segment handles and the empty-poll transaction IDs belong
+        # to the previously attached environment; after a re-attach (e.g.
+        # following a compaction) they would alias databases of the closed
+        # environment, so they are dropped here.
+        self._segment_dbs.clear()
+        self._thread_local = threading.local()
+
+        # A queue which was initialized before is attached with a read-only
+        # transaction; the write transaction with the database creation and
+        # the migrations only runs for genuinely new or not yet migrated
+        # queues.
+        if not self._attach_existing():
+            # Database handles stay valid for the lifetime of the
+            # environment, so they are resolved once here instead of on
+            # every operation.
+            with self.env.begin(write=True) as txn:
+                self.data_db = self.env.open_db(
+                    key=persipubsub.database.DATA_DB, txn=txn, create=True)
+                self.pending_db = self.env.open_db(
+                    key=persipubsub.database.PENDING_DB, txn=txn, create=True)
+                self.meta_db = self.env.open_db(
+                    key=persipubsub.database.META_DB, txn=txn, create=True)
+                self.queue_db = self.env.open_db(
+                    key=persipubsub.database.QUEUE_DB, txn=txn, create=True)
+                self.subscriber_db = self.env.open_db(
+                    key=persipubsub.database.SUBSCRIBER_DB, txn=txn,
+                    create=True)
+                self.cursor_db = self.env.open_db(
+                    key=persipubsub.database.CURSOR_DB, txn=txn, create=True)
+                self.zero_pending_db = self.env.open_db(
+                    key=persipubsub.database.ZERO_PENDING_DB, txn=txn,
+                    create=True)
+                self.ack_db = self.env.open_db(
+                    key=persipubsub.database.ACK_DB, txn=txn, create=True)
+
+            # Initialize the running counters from database statistics for
+            # queues which were written before the counters existed.
+            with self.env.begin(write=True) as txn:
+                if txn.get(
+                        key=persipubsub.database.NUM_MSGS_KEY,
+                        db=self.queue_db) is None:
+                    meta_stat = txn.stat(db=self.meta_db)
+                    txn.put(
+                        key=persipubsub.database.NUM_MSGS_KEY,
+                        value=persipubsub.database.int_to_bytes(
+                            meta_stat['entries']),
+                        db=self.queue_db)
+
+                # Queues written before the zero-pending index existed are
+                # migrated with one scan of the pending database.
+                if txn.get(
+                        key=persipubsub.database.ZERO_PENDING_INDEXED_KEY,
+                        db=self.queue_db) is None:
+                    cursor = txn.cursor(db=self.pending_db)
+                    if cursor.first():
+                        for key, pending_value in cursor.iternext(
+                                values=True):
+                            if persipubsub.database.bytes_to_int(
+                                    pending_value) == 0:
+                                txn.put(
+                                    key=key,
+                                    value=b'',
+                                    db=self.zero_pending_db)
+
+                    txn.put(
+                        key=persipubsub.database.ZERO_PENDING_INDEXED_KEY,
+                        value=persipubsub.database.int_to_bytes(1),
+                        db=self.queue_db)
+
+                if txn.get(
+                        key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                        db=self.queue_db) is None:
+                    data_stat = txn.stat(db=self.data_db)
+                    data_size_bytes = data_stat['psize'] * (
+                        data_stat['branch_pages'] + data_stat['leaf_pages']
+                        + data_stat['overflow_pages'])
+                    txn.put(
+                        key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                        value=persipubsub.database.int_to_bytes(
+                            data_size_bytes),
+                        db=self.queue_db)
+
+        with self.env.begin(write=False) as txn:
+            threshold_value = txn.get(
+                key=persipubsub.database.BLOB_THRESHOLD_KEY, db=self.queue_db)
+            self.blob_threshold = None if threshold_value is None \
+                else persipubsub.database.bytes_to_int(threshold_value)
+
+            compression_value = txn.get(
+                key=persipubsub.database.COMPRESSION_KEY, db=self.queue_db)
+            self.compression = None if compression_value is None \
+                else persipubsub.database.bytes_to_str(compression_value)
+
+            self._config_epoch = txn.get(
+                key=persipubsub.database.CONFIG_EPOCH_KEY, db=self.queue_db)
+
+            sample_value = txn.get(
+                key=persipubsub.database.RESIDENCY_SAMPLE_KEY,
+                db=self.queue_db)
+            self.residency_sample_interval = 0 if sample_value is None \
+                else persipubsub.database.bytes_to_int(sample_value)
+
+            # As long as undelivered messages of the old string-key format
+            # remain, new 8-byte IDs are out of order for LMDB and the
+            # writes fall back to ordinary puts.
+            meta_cursor = txn.cursor(db=self.meta_db)
+            self._append_writes = not meta_cursor.last() or len(
+                meta_cursor.key()) == persipubsub.database.BYTES_LENGTH
 
         queue_data = persipubsub.database.retrieve_queue_data(env=self.env)
 
@@ -259,176 +705,885 @@ class _Queue:
         self.strategy = _parse_strategy(identifier=queue_data.strategy)
 
         self.subscriber_ids = queue_data.subscriber_ids
+        self.subscriber_topics = queue_data.subscriber_topics
+        self.cursor_subscriber_ids = queue_data.cursor_subscriber_ids
+
+        for sub_id in self.subscriber_ids:
+            self.sub_dbs[sub_id] = self.env.open_db(
+                key=persipubsub.database.str_to_bytes(sub_id), create=False)
+
+        self.notifier = persipubsub.notification.Notifier(queue_dir=self.path)
+
+    def _attach_existing(self) -> bool:
+        """
+        Resolve the database handles of an initialized queue read-only.
+
+        :return:
+            True if all named databases exist and no migration is pending
+        """
+        assert self.env is not None
+        try:
+            with self.env.begin(write=False) as txn:
+                data_db = self.env.open_db(
+                    key=persipubsub.database.DATA_DB, txn=txn, create=False)
+                pending_db = self.env.open_db(
+                    key=persipubsub.database.PENDING_DB, txn=txn,
+                    create=False)
+                meta_db = self.env.open_db(
+                    key=persipubsub.database.META_DB, txn=txn, create=False)
+                queue_db = self.env.open_db(
+                    key=persipubsub.database.QUEUE_DB, txn=txn, create=False)
+                subscriber_db = self.env.open_db(
+                    key=persipubsub.database.SUBSCRIBER_DB, txn=txn,
+                    create=False)
+                cursor_db = self.env.open_db(
+                    key=persipubsub.database.CURSOR_DB, txn=txn, create=False)
+                zero_pending_db = self.env.open_db(
+                    key=persipubsub.database.ZERO_PENDING_DB, txn=txn,
+                    create=False)
+                ack_db = self.env.open_db(
+                    key=persipubsub.database.ACK_DB, txn=txn, create=False)
+
+                for migration_key in (
+                        persipubsub.database.NUM_MSGS_KEY,
+                        persipubsub.database.ZERO_PENDING_INDEXED_KEY,
+                        persipubsub.database.DATA_SIZE_BYTES_KEY):
+                    if txn.get(key=migration_key, db=queue_db) is None:
+                        return False
+        except lmdb.NotFoundError:
+            return False
+
+        self.data_db = data_db
+        self.pending_db = pending_db
+        self.meta_db = meta_db
+        self.queue_db = queue_db
+        self.subscriber_db = subscriber_db
+        self.cursor_db = cursor_db
+        self.zero_pending_db = zero_pending_db
+        self.ack_db = ack_db
+        return True
+
+    def _segment_db(self,
+                    segment: int,
+                    txn: Optional[lmdb.Transaction] = None,
+                    create: bool = True) -> Any:
+        """
+        Resolve the cached handle of a data segment database.
+
+        :param segment: generation number of the segment
+        :param txn: open transaction; required when create is set
+        :param create: if True, create the segment database when missing
+        :return: handle of the segment database; None when it does not exist
+        """
+        db = self._segment_dbs.get(segment, None)  # pylint: disable=invalid-name
+        if db is None:
+            assert self.env is not None
+            try:
+                db = self.env.open_db(
+                    key=persipubsub.database.data_segment_db_name(
+                        segment=segment),
+                    txn=txn,
+                    create=create)
+            except lmdb.NotFoundError:
+                return None
+            self._segment_dbs[segment] = db
+        return db
+
+    def data_db_for(self,
+                    msg_id: bytes,
+                    txn: Optional[lmdb.Transaction] = None,
+                    create: bool = True) -> Any:
+        """
+        Resolve the segment database which holds the data of a message.
+
+        :param msg_id: message ID as 8 bytes
+        :param txn: open transaction; required when create is set
+        :param create: if True, create the segment database when missing
+        :return: handle of the segment database; None when it does not exist
+        """
+        return self._segment_db(
+            segment=persipubsub.database.data_segment_of(msg_id=msg_id),
+            txn=txn,
+            create=create)
+
+    def _blob_path(self, msg_id: bytes) -> pathlib.Path:
+        """
+        Resolve the path of the sidecar blob file of a message.
+
+        The blob files are grouped in one directory per data segment, so
+        pruning a whole segment can remove its directory.
+
+        :param msg_id: message ID as 8 bytes
+        :return: path of the blob file
+        """
+        assert self.path is not None
+        segment = persipubsub.database.data_segment_of(msg_id=msg_id)
+        return self.path / persipubsub.database.BLOB_DIR / str(segment) / \
+            "{}.blob".format(persipubsub.database.bytes_to_int(msg_id))
+
+    def _store_blob(self, msg_id: bytes, msg: bytes) -> None:
+        """
+        Write the payload of a message to its sidecar blob file.
+
+        :param msg_id: message ID as 8 bytes
+        :param msg: message in bytes
+        """
+        blob_path = self._blob_path(msg_id=msg_id)
+        blob_path.parent.mkdir(parents=True, exist_ok=True)
+        blob_path.write_bytes(msg)
+
+    def _load_blob(self, msg_id: bytes) -> Optional[memoryview]:
+        """
+        Map the sidecar blob file of a message into memory.
+
+        :param msg_id: message ID as 8 bytes
+        :return:
+            read-only view of the memory-mapped blob; None when the blob
+            file does not exist
+        """
+        try:
+            with self._blob_path(msg_id=msg_id).open('rb') as blob_file:
+                mapped = mmap.mmap(
+                    blob_file.fileno(), length=0, access=mmap.ACCESS_READ)
+        except (FileNotFoundError, ValueError):
+            return None
+
+        # The view keeps the mapping alive; the mapping is released when
+        # the last view is garbage-collected.
+        return memoryview(mapped)
+
+    def _delete_blob(self, msg_id: bytes) -> None:
+        """
+        Delete the sidecar blob file of a message if there is one.
+
+        :param msg_id: message ID as 8 bytes
+        """
+        try:
+            self._blob_path(msg_id=msg_id).unlink()
+        except FileNotFoundError:
+            pass
+
+    def _delete_blob_segment(self, segment: int) -> None:
+        """
+        Delete all sidecar blob files of a data segment.
+
+        :param segment: generation number of the segment
+        """
+        assert self.path is not None
+        shutil.rmtree(
+            (self.path / persipubsub.database.BLOB_DIR /
+             str(segment)).as_posix(),
+            ignore_errors=True)
+
+    def _get_data(self, txn: lmdb.Transaction,
+                  key: bytes) -> Optional[Union[bytes, memoryview]]:
+        """
+        Read the data of a message from its segment database.
+
+        Messages written before the data was segmented are read from the
+        legacy single data database. Payloads spilled to sidecar blob
+        files are returned as a view of the memory-mapped blob instead of
+        a copy.
+
+        :param txn: open transaction
+        :param key: message ID
+        :return: message in bytes; None when the message does not exist
+        """
+        msg = None
+        seg_db = self.data_db_for(msg_id=key, create=False)
+        if seg_db is not None:
+            try:
+                msg = txn.get(key=key, db=seg_db)
+            except lmdb.Error:
+                # The segment was dropped by another process; the cached
+                # handle is gone.
+                self._segment_dbs.pop(
+                    persipubsub.database.data_segment_of(msg_id=key), None)
+
+        if msg is None:
+            msg = txn.get(key=key, db=self.data_db)
+
+        marker = persipubsub.database.BLOB_MARKER
+        if msg is not None and bytes(msg[:len(marker)]) == marker:
+            return self._load_blob(msg_id=bytes(key))
+
+        compression_marker = persipubsub.database.COMPRESSION_MARKER
+        if msg is not None and \
+                bytes(msg[:len(compression_marker)]) == compression_marker:
+            return _maybe_decompress(value=bytes(msg))
+
+        return msg
+
+    def _existing_data_segments(self,
+                                txn: lmdb.Transaction) -> List[int]:
+        """
+        List the generation numbers of all existing data segment databases.
+
+        :param txn: open transaction
+        :return: generation numbers of the segments
+        """
+        prefix = persipubsub.database.str_to_bytes(
+            persipubsub.database.DATA_SEGMENT_PREFIX)
+        segments = []  # type: List[int]
+        cursor = txn.cursor()
+        for key in cursor.iternext(keys=True, values=False):
+            if key.startswith(prefix):
+                segments.append(
+                    int(persipubsub.database.bytes_to_str(key[len(prefix):])))
+
+        return segments
+
+    def sub_db(self, sub_id: str) -> Any:
+        """
+        Resolve the cached database handle of a subscriber.
+
+        Handles of subscribers which joined after the queue was initialized
+        are resolved lazily and cached as well.
+
+        :param sub_id: Subscriber ID
+        :return: database handle of the subscriber
+        """
+        db = self.sub_dbs.get(sub_id, None)  # pylint: disable=invalid-name
+        if db is None:
+            assert self.env is not None
+            db = self.env.open_db(
+                key=persipubsub.database.str_to_bytes(sub_id), create=False)
+            self.sub_dbs[sub_id] = db
+        return db
+
+    def _refresh_config_if_changed(self, txn: lmdb.Transaction) -> bool:
+        """
+        Re-read the cached queue metadata when the config epoch changed.
+
+        Controls bump the epoch counter on every subscriber mutation, so a
+        stale subscriber set is detected with a single 8-byte read on the
+        hot path; the subscriber database is only iterated when the epoch
+        actually changed.
+
+        :param txn: open transaction on the environment
+        :return: True if the metadata was re-read
+        """
+        assert self.env is not None
+        epoch = txn.get(
+            key=persipubsub.database.CONFIG_EPOCH_KEY, db=self.queue_db)
+        if epoch == self._config_epoch:
+            return False
+
+        subscriber_topics = {}  # type: Dict[str, Optional[str]]
+        cursor_subscriber_ids = set()  # type: Set[str]
+        cursor = txn.cursor(db=self.subscriber_db)
+        for subscriber_id, pattern in cursor.iternext(values=True):
+            if pattern == persipubsub.database.CURSOR_SUBSCRIBER_MARKER:
+                cursor_subscriber_ids.add(
+                    persipubsub.database.bytes_to_str(subscriber_id))
+            else:
+                subscriber_topics[persipubsub.database.bytes_to_str(
+                    subscriber_id)] = \
+                    persipubsub.database.bytes_to_str(pattern) \
+                    if pattern else None
+
+        self.subscriber_ids = set(subscriber_topics.keys())
+        self.subscriber_topics = subscriber_topics
+        self.cursor_subscriber_ids = cursor_subscriber_ids
+
+        sub_dbs = {}  # type: Dict[str, Any]
+        for sub_id in self.subscriber_ids:
+            sub_dbs[sub_id] = self.env.open_db(
+                key=persipubsub.database.str_to_bytes(sub_id),
+                txn=txn,
+                create=False)
+        self.sub_dbs = sub_dbs
+
+        self._config_epoch = epoch
+        return True
+
+    def _receivers(self, topic: Optional[str]) -> List[str]:
+        """
+        List the subscribers whose subscription matches the topic.
+
+        :param topic: of the message; None reaches every subscriber
+        :return: IDs of the matching subscribers
+        """
+        assert self.subscriber_ids is not None
+        return [
+            sub for sub in self.subscriber_ids if _topic_matches(
+                pattern=self.subscriber_topics.get(sub, None), topic=topic)
+        ]
+
+    def _cursor_position(self,
+                         txn: lmdb.Transaction,
+                         sub_id: str,
+                         after: Optional[bytes] = None) -> Optional[bytes]:
+        """
+        Resolve the last consumed message ID of a cursor subscriber.
+
+        Message IDs are fixed-length big-endian, so the bytes compare like
+        the integers they encode.
+
+        :param txn: open transaction
+        :param sub_id: Subscriber ID
+        :param after: lower bound which overrides an older position
+        :return: ID below which all messages count as consumed; None if all
+            messages are unconsumed
+        """
+        position = txn.get(
+            key=persipubsub.database.str_to_bytes(sub_id), db=self.cursor_db)
+        if position is None:
+            return after
+        if after is None or position >= after:
+            return position
+        return after
 
     @icontract.require(lambda self: not self.closed)
-    def put(self, msg: bytes) -> None:
+    def put(self, msg: bytes, topic: Optional[str] = None) -> None:
         """
         Put message to LMDB in one transaction.
 
+        The message key is written only into the databases of the
+        subscribers whose subscription matches the topic; when no
+        subscription matches, nothing is written.
+
         :param msg: message in bytes
+        :param topic: of the message; None reaches every subscriber
         :return:
         """
-        # every publisher always prunes queue before sending a message.
-        self.cleanup()
-        msg_id = str(datetime.datetime.utcnow().timestamp()) + str(uuid.uuid4())
+        # By default every publisher prunes the queue before sending a
+        # message; with a larger maintenance interval the cleanup cost is
+        # amortized over many messages.
+        self.maybe_cleanup()
         assert self.env is not None
         assert self.subscriber_ids is not None
+        receivers = self._receivers(topic=topic)
+        if not receivers and not self.cursor_subscriber_ids:
+            # The early return must still observe subscriber changes, so
+            # the config epoch is checked with one read transaction.
+            with self.env.begin(write=False) as txn:
+                self._refresh_config_if_changed(txn=txn)
+            receivers = self._receivers(topic=topic)
+            if not receivers and not self.cursor_subscriber_ids:
+                return
+
+        start = time.perf_counter()
         with self.env.begin(write=True) as txn:
-            pending_db = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
+            if self._refresh_config_if_changed(txn=txn):
+                receivers = self._receivers(topic=topic)
+
+            msg_id = _generate_msg_id(txn=txn, meta_db=self.meta_db)
+
+            if self.blob_threshold is not None \
+                    and len(msg) >= self.blob_threshold:
+                self._store_blob(msg_id=msg_id, msg=msg)
+                stored_value = persipubsub.database.BLOB_MARKER
+            elif self.compression is not None:
+                stored_value = _compress(codec=self.compression, msg=msg)
+            else:
+                stored_value = msg
+
             txn.put(
-                key=persipubsub.database.str_to_bytes(msg_id),
-                value=persipubsub.database.int_to_bytes(
-                    len(self.subscriber_ids)),
-                db=pending_db)
+                key=msg_id,
+                value=persipubsub.database.int_to_bytes(len(receivers)),
+                db=self.pending_db,
+                append=self._append_writes)
+            if not receivers:
+                # Only cursor subscribers read the message; it counts as
+                # zero-pending from the start.
+                txn.put(key=msg_id, value=b'', db=self.zero_pending_db)
 
-            meta_db = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=False)
             txn.put(
-                key=persipubsub.database.str_to_bytes(msg_id),
+                key=msg_id,
                 value=persipubsub.database.int_to_bytes(
                     int(datetime.datetime.utcnow().timestamp())),
-                db=meta_db)
+                db=self.meta_db,
+                append=self._append_writes)
 
-            data_db = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=False)
             txn.put(
-                key=persipubsub.database.str_to_bytes(msg_id),
-                value=msg,
-                db=data_db)
+                key=msg_id,
+                value=stored_value,
+                db=self.data_db_for(msg_id=msg_id, txn=txn),
+                append=self._append_writes)
 
-            for sub in self.subscriber_ids:
-                sub_db = self.env.open_db(
-                    key=persipubsub.database.str_to_bytes(sub),
-                    txn=txn,
-                    create=False)
+            for sub in receivers:
                 txn.put(
-                    key=persipubsub.database.str_to_bytes(msg_id), db=sub_db)
+                    key=msg_id,
+                    db=self.sub_db(sub_id=sub),
+                    append=self._append_writes)
+
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.NUM_MSGS_KEY,
+                delta=1)
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                delta=len(msg))
+
+            # The commit happens when the transaction context is left.
+            before_commit = time.perf_counter()
+
+        self.metrics.record(operation='commit', start=before_commit)
+        self.metrics.record(operation='put', start=start)
+        self.metrics.count(counter='msgs_put')
+
+        assert self.notifier is not None
+        self.notifier.notify(
+            sub_ids=receivers + list(self.cursor_subscriber_ids))
 
     @icontract.require(lambda self: not self.closed)
-    def put_many_flush_once(self, msgs: List[bytes]) -> None:
+    def put_many_flush_once(self,
+                            msgs: List[bytes],
+                            topic: Optional[str] = None) -> None:
         """
         Put multiple message to LMDB in one transaction.
 
+        The key/value pairs are first collected per named database and then
+        pushed with one bulk cursor write (putmulti) per database, so the
+        whole batch costs only a handful of native calls instead of 3+N
+        puts per message.
+
+        The message keys are written only into the databases of the
+        subscribers whose subscription matches the topic; when no
+        subscription matches, nothing is written.
+
         :param msgs: messages in bytes
+        :param topic: of all messages in the batch; None reaches everybody
         :return:
         """
-        # every publisher always prunes queue before sending a message.
-        self.cleanup()
+        # By default every publisher prunes the queue before sending a
+        # message; with a larger maintenance interval the cleanup cost is
+        # amortized over many messages.
+        self.maybe_cleanup(batch_size=len(msgs))
         assert self.env is not None
         assert self.subscriber_ids is not None
+        receivers = self._receivers(topic=topic)
+        if not receivers and not self.cursor_subscriber_ids:
+            # The early return must still observe subscriber changes, so
+            # the config epoch is checked with one read transaction.
+            with self.env.begin(write=False) as txn:
+                self._refresh_config_if_changed(txn=txn)
+            receivers = self._receivers(topic=topic)
+            if not receivers and not self.cursor_subscriber_ids:
+                return
+
+        start = time.perf_counter()
         with self.env.begin(write=True) as txn:
+            if self._refresh_config_if_changed(txn=txn):
+                receivers = self._receivers(topic=topic)
 
-            pending_db = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
+            msg_id_int = persipubsub.database.bytes_to_int(
+                _generate_msg_id(txn=txn, meta_db=self.meta_db))
 
-            meta_db = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=False)
+            pending_value = persipubsub.database.int_to_bytes(len(receivers))
+            timestamp_value = persipubsub.database.int_to_bytes(
+                int(datetime.datetime.utcnow().timestamp()))
 
-            data_db = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=False)
-
-            sub_dbs = set()  # type: Set[lmdb.Environment]
-            for sub in self.subscriber_ids:
-                sub_dbs.add(
-                    self.env.open_db(
-                        key=persipubsub.database.str_to_bytes(sub),
-                        txn=txn,
-                        create=False))
+            pending_items = []  # type: List[Tuple[bytes, bytes]]
+            meta_items = []  # type: List[Tuple[bytes, bytes]]
+            data_items_per_segment = \
+                {}  # type: Dict[int, List[Tuple[bytes, bytes]]]
+            sub_items = []  # type: List[Tuple[bytes, bytes]]
 
             for msg in msgs:
-                msg_id = str(datetime.datetime.utcnow().timestamp()) + str(
-                    uuid.uuid4())
+                msg_id = persipubsub.database.int_to_bytes(msg_id_int)
+                msg_id_int += 1
+
+                if self.blob_threshold is not None \
+                        and len(msg) >= self.blob_threshold:
+                    self._store_blob(msg_id=msg_id, msg=msg)
+                    stored_value = persipubsub.database.BLOB_MARKER
+                elif self.compression is not None:
+                    stored_value = _compress(codec=self.compression, msg=msg)
+                else:
+                    stored_value = msg
+
+                pending_items.append((msg_id, pending_value))
+                meta_items.append((msg_id, timestamp_value))
+                segment = persipubsub.database.data_segment_of(msg_id=msg_id)
+                data_items_per_segment.setdefault(segment, []).append(
+                    (msg_id, stored_value))
+                sub_items.append((msg_id, b''))
+
+            txn.cursor(db=self.pending_db).putmulti(
+                items=pending_items, append=self._append_writes)
+            if not receivers:
+                # Only cursor subscribers read the batch; the messages
+                # count as zero-pending from the start.
+                txn.cursor(db=self.zero_pending_db).putmulti(
+                    items=sub_items, append=self._append_writes)
+            txn.cursor(db=self.meta_db).putmulti(
+                items=meta_items, append=self._append_writes)
+
+            for segment, data_items in data_items_per_segment.items():
+                txn.cursor(db=self._segment_db(
+                    segment=segment, txn=txn)).putmulti(
+                        items=data_items, append=self._append_writes)
+
+            for sub in receivers:
+                txn.cursor(db=self.sub_db(sub_id=sub)).putmulti(
+                    items=sub_items, append=self._append_writes)
+
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.NUM_MSGS_KEY,
+                delta=len(msgs))
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                delta=sum(len(msg) for msg in msgs))
 
-                txn.put(
-                    key=persipubsub.database.str_to_bytes(msg_id),
-                    value=persipubsub.database.int_to_bytes(
-                        len(self.subscriber_ids)),
-                    db=pending_db)
+            # The commit happens when the transaction context is left.
+            before_commit = time.perf_counter()
 
-                txn.put(
-                    key=persipubsub.database.str_to_bytes(msg_id),
-                    value=persipubsub.database.int_to_bytes(
-                        int(datetime.datetime.utcnow().timestamp())),
-                    db=meta_db)
+        self.metrics.record(operation='commit', start=before_commit)
+        self.metrics.record(operation='put', start=start)
+        self.metrics.count(counter='msgs_put', delta=len(msgs))
 
-                txn.put(
-                    key=persipubsub.database.str_to_bytes(msg_id),
-                    value=msg,
-                    db=data_db)
+        assert self.notifier is not None
+        self.notifier.notify(
+            sub_ids=receivers + list(self.cursor_subscriber_ids))
 
-                for sub_db in sub_dbs:
-                    txn.put(
-                        key=persipubsub.database.str_to_bytes(msg_id),
-                        db=sub_db)
+    def _maybe_record_residency(self, sub_id: str, msg_id: bytes) -> None:
+        """
+        Record the queue residency of every N-th received message.
+
+        The message ID is the publish timestamp in nanoseconds, so the
+        residency is a subtraction of the ID from the current time without
+        any additional read.
+
+        :param sub_id: subscriber which received the message
+        :param msg_id: ID of the received message
+        :return:
+        """
+        if self.residency_sample_interval <= 0:
+            return
+
+        self._residency_sample_counter += 1
+        if self._residency_sample_counter % self.residency_sample_interval \
+                != 0:
+            return
+
+        residency = datetime.datetime.utcnow().timestamp() - \
+            persipubsub.database.bytes_to_int(msg_id) / 10**9
+        # Colliding IDs are bumped past the last stored one, so a freshly
+        # published message can carry an ID slightly in the future.
+        if residency < 0:
+            residency = 0.0
+
+        self.metrics.record_residency(sub_id=sub_id, duration=residency)
 
     @icontract.require(lambda self: not self.closed)
-    def front(self, sub_id: str) -> Tuple[Optional[bytes], Optional[bytes]]:
+    def front(self,
+              sub_id: str,
+              after: Optional[bytes] = None
+              ) -> Tuple[Optional[bytes], Optional[bytes]]:
         """
         Peek at next message in LMDB.
 
         Load from LMDB into memory and process msg afterwards.
 
+        If the previous call found no message and no write transaction
+        committed since, the call returns immediately without opening a
+        read transaction, so polling an empty queue does not pay the
+        lock-table slot acquisition on every call.
+
         :param sub_id: Subscriber ID
+        :param after:
+            if set, peek at the first message with an ID greater than this
+            one; message IDs are monotonic, so this skips all older messages
         :return:
         """
         assert self.env is not None
+        start = time.perf_counter()
+
+        # The environment info is read before the transaction begins, so a
+        # write which commits in between is re-checked on the next poll
+        # instead of being missed.
+        last_txnid = self.env.info()['last_txnid']
+        empty_polls = getattr(self._thread_local, 'empty_polls', None) \
+            # type: Optional[Dict[Tuple[str, Optional[bytes]], int]]
+        if empty_polls is not None \
+                and empty_polls.get((sub_id, after)) == last_txnid:
+            self.metrics.record(operation='front', start=start)
+            return None, None
+
         with self.env.begin(write=False) as txn:
-            sub_db = self.env.open_db(
-                key=persipubsub.database.str_to_bytes(sub_id),
-                txn=txn,
-                create=False)
-            data_db = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=False)
+            if sub_id in self.cursor_subscriber_ids:
+                cursor = txn.cursor(db=self.meta_db)
+                lower = self._cursor_position(
+                    txn=txn, sub_id=sub_id, after=after)
+            else:
+                cursor = txn.cursor(db=self.sub_db(sub_id=sub_id))
+                lower = after
 
-            cursor = txn.cursor(db=sub_db)
             # check if database is not empty
-            if cursor.first():
+            if lower is None:
+                found = cursor.first()
+            else:
+                found = cursor.set_range(
+                    persipubsub.database.int_to_bytes(
+                        persipubsub.database.bytes_to_int(lower) + 1))
+
+            if found:
                 key = cursor.key()
-                msg = txn.get(key=key, db=data_db)
+                msg = self._get_data(txn=txn, key=key)
             else:
                 key = None
                 msg = None
 
+        if msg is None:
+            if empty_polls is None:
+                empty_polls = {}
+                self._thread_local.empty_polls = empty_polls
+            empty_polls[(sub_id, after)] = last_txnid
+        elif empty_polls is not None:
+            empty_polls.pop((sub_id, after), None)
+
+        if key is not None:
+            self._maybe_record_residency(sub_id=sub_id, msg_id=key)
+
+        self.metrics.record(operation='front', start=start)
         return key, msg
 
     @icontract.require(lambda self: not self.closed)
-    def pop(self, sub_id: str, msg_id: Optional[bytes] = None) -> None:
+    @icontract.require(lambda max_msgs: max_msgs > 0)
+    def front_many(self, sub_id: str,
+                   max_msgs: int) -> List[Tuple[bytes, bytes]]:
         """
-        Remove msg from the subscriber's queue and reduce pending subscribers.
+        Peek at up to max_msgs messages in one read transaction.
 
         :param sub_id: Subscriber ID
+        :param max_msgs: maximal number of messages to peek at
+        :return: message ID and message pairs, oldest message first
+        """
+        msgs = []  # type: List[Tuple[bytes, bytes]]
+        assert self.env is not None
+        with self.env.begin(write=False) as txn:
+            if sub_id in self.cursor_subscriber_ids:
+                cursor = txn.cursor(db=self.meta_db)
+                lower = self._cursor_position(txn=txn, sub_id=sub_id)
+            else:
+                cursor = txn.cursor(db=self.sub_db(sub_id=sub_id))
+                lower = None
+
+            # check if database is not empty
+            if lower is None:
+                found = cursor.first()
+            else:
+                found = cursor.set_range(
+                    persipubsub.database.int_to_bytes(
+                        persipubsub.database.bytes_to_int(lower) + 1))
+
+            if found:
+                for key in cursor.iternext(keys=True, values=False):
+                    msgs.append((key, self._get_data(txn=txn, key=key)))
+                    if len(msgs) == max_msgs:
+                        break
+
+        return msgs
+
+    @icontract.require(lambda self: not self.closed)
+    def pop_many(self, sub_id: str, msg_ids: List[bytes]) -> None:
+        """
+        Remove multiple msgs from the subscriber's queue in one transaction.
+
+        An ack mark is written for every message as well.
+
+        :param sub_id: Subscriber ID
+        :param msg_ids: IDs of the messages which should be popped
         :return:
         """
         assert self.env is not None
+        start = time.perf_counter()
         with self.env.begin(write=True) as txn:
-            sub_db = self.env.open_db(
-                key=persipubsub.database.str_to_bytes(sub_id),
-                txn=txn,
-                create=False)
-            pending_db = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
+            if sub_id in self.cursor_subscriber_ids:
+                # A cursor subscriber is popped by advancing its position.
+                txn.put(
+                    key=persipubsub.database.str_to_bytes(sub_id),
+                    value=max(msg_ids),
+                    db=self.cursor_db)
+            else:
+                sub_db = self.sub_db(sub_id=sub_id)
+                for key in msg_ids:
+                    if not txn.delete(key=key, db=sub_db):
+                        raise RuntimeError("No message to pop")
+
+                    # The ack is a blind write under a per-subscriber
+                    # composite key, so subscribers do not serialize on
+                    # one shared counter.
+                    txn.put(
+                        key=persipubsub.database.ack_key(
+                            msg_id=key, sub_id=sub_id),
+                        value=b'',
+                        db=self.ack_db)
 
-            cursor = txn.cursor(db=sub_db)
+        self.metrics.record(operation='pop', start=start)
+        self.metrics.count(counter='msgs_popped', delta=len(msg_ids))
+
+    @icontract.require(lambda self: not self.closed)
+    def pop_to_newest(self, sub_id: str) -> int:
+        """
+        Remove all but the newest msg from the subscriber's queue.
+
+        All messages are deleted in a single cursor pass within one write
+        transaction, so skipping a large backlog does not pay one write
+        transaction per message. An ack mark is written for every popped
+        message as well.
+
+        :param sub_id: Subscriber ID
+        :return: number of popped messages
+        """
+        assert self.env is not None
+        start = time.perf_counter()
+        popped_num = 0
+        with self.env.begin(write=True) as txn:
+            if sub_id in self.cursor_subscriber_ids:
+                cursor = txn.cursor(db=self.meta_db)
+                lower = self._cursor_position(txn=txn, sub_id=sub_id)
+                if lower is None:
+                    found = cursor.first()
+                else:
+                    found = cursor.set_range(
+                        persipubsub.database.int_to_bytes(
+                            persipubsub.database.bytes_to_int(lower) + 1))
+
+                if found:
+                    keys = list(cursor.iternext(keys=True, values=False))
+                    if len(keys) > 1:
+                        popped_num = len(keys) - 1
+                        txn.put(
+                            key=persipubsub.database.str_to_bytes(sub_id),
+                            value=keys[-2],
+                            db=self.cursor_db)
+
+                self.metrics.record(operation='pop', start=start)
+                self.metrics.count(counter='msgs_popped', delta=popped_num)
+                return popped_num
+
+            cursor = txn.cursor(db=self.sub_db(sub_id=sub_id))
             # check if database is not empty
             if cursor.first():
-                if msg_id is None:
+                while cursor.next():
+                    cursor.prev()
                     key = cursor.key()
+                    cursor.delete()
+                    popped_num += 1
+
+                    txn.put(
+                        key=persipubsub.database.ack_key(
+                            msg_id=bytes(key), sub_id=sub_id),
+                        value=b'',
+                        db=self.ack_db)
+
+        self.metrics.record(operation='pop', start=start)
+        self.metrics.count(counter='msgs_popped', delta=popped_num)
+        return popped_num
+
+    @icontract.require(lambda self: not self.closed)
+    @contextlib.contextmanager
+    def front_buffer(
+            self, sub_id: str
+    ) -> Iterator[Tuple[Optional[bytes], Optional[memoryview]]]:
+        """
+        Peek at next message in LMDB without copying it out of the map.
+
+        The message is yielded as a buffer view directly into the
+        memory-mapped file (lmdb buffers=True), so large messages are not
+        copied into a Python bytes object. The view is only valid within
+        the context; copy it if you need it afterwards.
+
+        :param sub_id: Subscriber ID
+        :return:
+            Iterator because of decorator which contains the message ID and
+            a buffer view of the message
+        """
+        assert self.env is not None
+        with self.env.begin(write=False, buffers=True) as txn:
+            if sub_id in self.cursor_subscriber_ids:
+                cursor = txn.cursor(db=self.meta_db)
+                lower = self._cursor_position(txn=txn, sub_id=sub_id)
+                if lower is None:
+                    found = cursor.first()
                 else:
-                    key = msg_id
+                    found = cursor.set_range(
+                        persipubsub.database.int_to_bytes(
+                            persipubsub.database.bytes_to_int(
+                                bytes(lower)) + 1))
+            else:
+                cursor = txn.cursor(db=self.sub_db(sub_id=sub_id))
+                found = cursor.first()
+
+            # check if database is not empty
+            if found:
+                # The key is copied since it is small and needed to pop the
+                # message after the transaction is gone.
+                key = bytes(cursor.key())  # type: Optional[bytes]
+                msg = self._get_data(txn=txn, key=key)
+            else:
+                key = None
+                msg = None
+
+            yield key, msg
+
+    @icontract.require(lambda self: not self.closed)
+    def pop(self, sub_id: str, msg_id: Optional[bytes] = None) -> None:
+        """
+        Remove msg from the subscriber's queue and record the acknowledgment.
+
+        :param sub_id: Subscriber ID
+        :return:
+        """
+        assert self.env is not None
+        start = time.perf_counter()
+        with self.env.begin(write=True) as txn:
+            if sub_id in self.cursor_subscriber_ids:
+                # A cursor subscriber is popped by advancing its position;
+                # the write is a single 8-byte value update.
+                key = msg_id
+                if key is None:
+                    cursor = txn.cursor(db=self.meta_db)
+                    lower = self._cursor_position(txn=txn, sub_id=sub_id)
+                    if lower is None:
+                        found = cursor.first()
+                    else:
+                        found = cursor.set_range(
+                            persipubsub.database.int_to_bytes(
+                                persipubsub.database.bytes_to_int(lower) + 1))
+
+                    if not found:
+                        raise RuntimeError("No message to pop")
+                    key = cursor.key()
 
-                cursor.pop(key=key)
-                pending_value = txn.get(key=key, db=pending_db)
-                pending_num = persipubsub.database.bytes_to_int(pending_value)
-                decreased_pending_num = pending_num - 1
-                assert decreased_pending_num >= 0
                 txn.put(
-                    key=key,
-                    value=persipubsub.database.int_to_bytes(
-                        decreased_pending_num),
-                    db=pending_db)
+                    key=persipubsub.database.str_to_bytes(sub_id),
+                    value=key,
+                    db=self.cursor_db)
             else:
-                raise RuntimeError("No message to pop")
+                cursor = txn.cursor(db=self.sub_db(sub_id=sub_id))
+                # check if database is not empty
+                if cursor.first():
+                    if msg_id is None:
+                        key = cursor.key()
+                    else:
+                        key = msg_id
+
+                    cursor.pop(key=key)
+                    # The ack is a blind write under a per-subscriber
+                    # composite key, so subscribers do not serialize on
+                    # one shared counter.
+                    txn.put(
+                        key=persipubsub.database.ack_key(
+                            msg_id=bytes(key), sub_id=sub_id),
+                        value=b'',
+                        db=self.ack_db)
+                else:
+                    raise RuntimeError("No message to pop")
+
+        self._maybe_record_residency(sub_id=sub_id, msg_id=bytes(key))
+        self.metrics.record(operation='pop', start=start)
+        self.metrics.count(counter='msgs_popped')
 
     @icontract.require(lambda self: not self.closed)
     def prune_dangling_messages(self) -> None:
@@ -447,20 +1602,24 @@ class _Queue:
     @icontract.require(lambda self: not self.closed)
     def check_current_lmdb_size(self) -> int:
         """
-        Check current LMDB size in bytes.
+        Check current size of the stored message data in bytes.
 
-        Check size of data database by approximating size with multiplying page
-        size with number of pages.
+        Read the running data-size counter in constant time; queues written
+        before the counter existed fall back to approximating the size of
+        the data database with page size times number of pages.
 
-        :return: data database size in bytes
+        :return: size of the stored message data in bytes
         """
-        lmdb_size_bytes = 0
         assert self.env is not None
         with self.env.begin(write=False) as txn:
-            data_db = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=False)
-            data_stat = txn.stat(db=data_db)
-            lmdb_size_bytes += data_stat['psize'] * (
+            value = txn.get(
+                key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                db=self.queue_db)
+            if value is not None:
+                return persipubsub.database.bytes_to_int(value)
+
+            data_stat = txn.stat(db=self.data_db)
+            lmdb_size_bytes = data_stat['psize'] * (
                 data_stat['branch_pages'] + data_stat['leaf_pages'] +
                 data_stat['overflow_pages'])
 
@@ -469,18 +1628,48 @@ class _Queue:
     @icontract.require(lambda self: not self.closed)
     def count_msgs(self) -> int:
         """
-        Count number of messages stored in named database 'meta_db'.
+        Count number of messages stored in the queue.
+
+        Read the running message counter in constant time; queues written
+        before the counter existed fall back to the statistics of the named
+        database 'meta_db'.
 
         :return: number of messages in database
         """
         assert self.env is not None
         with self.env.begin(write=False) as txn:
-            meta_db = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=False)
-            meta_stat = txn.stat(db=meta_db)  # type: Dict[str, int]
+            value = txn.get(
+                key=persipubsub.database.NUM_MSGS_KEY, db=self.queue_db)
+            if value is not None:
+                return persipubsub.database.bytes_to_int(value)
+
+            meta_stat = txn.stat(db=self.meta_db)  # type: Dict[str, int]
 
         return meta_stat['entries']
 
+    @icontract.require(lambda self: not self.closed)
+    def maybe_cleanup(self, batch_size: int = 1) -> None:
+        """
+        Clean database unless cleanup ran recently.
+
+        The cleanup runs at most every cleanup_interval_msgs published
+        messages or cleanup_interval_secs seconds, whichever comes first.
+        With the default intervals the cleanup runs before every message.
+
+        :param batch_size: number of messages about to be published
+        :return:
+        """
+        self._msgs_since_cleanup += batch_size
+        timestamp_now = datetime.datetime.utcnow().timestamp()
+        if self._msgs_since_cleanup < self.cleanup_interval_msgs \
+                and timestamp_now - self._last_cleanup_timestamp \
+                < self.cleanup_interval_secs:
+            return
+
+        self.cleanup()
+        self._msgs_since_cleanup = 0
+        self._last_cleanup_timestamp = timestamp_now
+
     @icontract.require(lambda self: not self.closed)
     def cleanup(self) -> None:
         """
@@ -494,14 +1683,18 @@ class _Queue:
         :return:
         """
         assert self.hwm is not None
+        start = time.perf_counter()
         self.prune_dangling_messages()
         msgs_num = self.count_msgs()
         if msgs_num >= self.hwm.max_messages:
             self.prune_half_of_messages()
         lmdb_size_bytes = self.check_current_lmdb_size()
-        if lmdb_size_bytes >= self.hwm.hwm_lmdb_size:
+        if lmdb_size_bytes > self.hwm.hwm_lmdb_size:
             self.prune_half_of_messages()
 
+        self.metrics.record(operation='cleanup', start=start)
+        self.metrics.count(counter='cleanup_runs')
+
     @icontract.require(lambda self: not self.closed)
     def prune_half_of_messages(self) -> None:
         """
@@ -515,12 +1708,10 @@ class _Queue:
         messages_to_delete = set()  # type: Set[bytes]
         assert self.env is not None
         with self.env.begin(write=False) as txn:
-            meta_db = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=False)
-            meta_stat = txn.stat(db=meta_db)
+            meta_stat = txn.stat(db=self.meta_db)
             entries = meta_stat['entries']
 
-            cursor = txn.cursor(db=meta_db)
+            cursor = txn.cursor(db=self.meta_db)
             if self.strategy == Strategy.PRUNE_FIRST:
 
                 cursor.first()
@@ -542,22 +1733,73 @@ class _Queue:
 
         assert self.subscriber_ids is not None
         with self.env.begin(write=True) as txn:
-            pending_db = self.env.open_db(
-                key=persipubsub.database.PENDING_DB, txn=txn, create=False)
-            meta_db = self.env.open_db(
-                key=persipubsub.database.META_DB, txn=txn, create=False)
-            data_db = self.env.open_db(
-                key=persipubsub.database.DATA_DB, txn=txn, create=False)
-
-            dbs = [pending_db, meta_db, data_db]
+            dbs = [
+                self.pending_db, self.zero_pending_db, self.meta_db,
+                self.data_db
+            ]
 
             for sub in self.subscriber_ids:
-                sub_db = self.env.open_db(
-                    key=persipubsub.database.str_to_bytes(sub),
-                    txn=txn,
-                    create=False)
-                dbs.append(sub_db)
+                dbs.append(self.sub_db(sub_id=sub))
+
+            deleted_num = 0
+            deleted_size_bytes = 0
+            for key in messages_to_delete:
+                data_value = self._get_data(txn=txn, key=key)
+                if data_value is not None:
+                    deleted_num += 1
+                    deleted_size_bytes += len(data_value)
+
+            # The pruned messages form a contiguous ID range, hence all
+            # data segments which lie entirely within the range are dropped
+            # wholesale; only the boundary segment is deleted key by key.
+            dropped_segments = set()  # type: Set[int]
+            if messages_to_delete:
+                if self.strategy == Strategy.PRUNE_FIRST:
+                    boundary_segment = persipubsub.database.data_segment_of(
+                        msg_id=max(messages_to_delete))
+                    droppable = [
+                        segment for segment in self._existing_data_segments(
+                            txn=txn) if segment < boundary_segment
+                    ]
+                else:
+                    boundary_segment = persipubsub.database.data_segment_of(
+                        msg_id=min(messages_to_delete))
+                    droppable = [
+                        segment for segment in self._existing_data_segments(
+                            txn=txn) if segment > boundary_segment
+                    ]
+
+                for segment in droppable:
+                    seg_db = self._segment_db(
+                        segment=segment, txn=txn, create=False)
+                    if seg_db is not None:
+                        txn.drop(db=seg_db, delete=True)
+                        self._segment_dbs.pop(segment, None)
+                        dropped_segments.add(segment)
+                    self._delete_blob_segment(segment=segment)
 
             for key in messages_to_delete:
+                segment = persipubsub.database.data_segment_of(msg_id=key)
+                if segment not in dropped_segments:
+                    seg_db = self.data_db_for(msg_id=key, create=False)
+                    if seg_db is not None:
+                        txn.delete(key=key, db=seg_db)
+                    self._delete_blob(msg_id=key)
+
+                _delete_acks_for(txn=txn, ack_db=self.ack_db, msg_id=key)
                 for db in dbs:  # pylint: disable=invalid-name
                     txn.delete(key=key, db=db)
+
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.NUM_MSGS_KEY,
+                delta=-deleted_num)
+            _add_to_counter(
+                txn=txn,
+                queue_db=self.queue_db,
+                key=persipubsub.database.DATA_SIZE_BYTES_KEY,
+                delta=-deleted_size_bytes)
+
+        self.metrics.count(counter='prune_runs')
+        self.metrics.count(counter='msgs_pruned', delta=deleted_num)
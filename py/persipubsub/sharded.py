@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+"""Scale a queue past the single-writer lock with sharded environments."""
+
+import contextlib
+import datetime
+import pathlib
+import threading
+import time
+from typing import Any, Iterator, List, Optional, Set
+
+import icontract
+
+import persipubsub.control
+import persipubsub.environment
+import persipubsub.publisher
+import persipubsub.queue
+import persipubsub.subscriber
+
+# pylint: disable=protected-access
+
+#: Default number of shards of a sharded queue
+DEFAULT_SHARD_NUM = 4  # type: int
+#: Prefix of the shard directories below the queue directory
+SHARD_DIR_PREFIX = "shard_"  # type: str
+
+
+class ShardedEnvironment:
+    """
+    Provide a queue sharded over multiple LMDB environments.
+
+    LMDB permits exactly one write transaction per environment, so a single
+    queue stops scaling with additional publisher processes once the writer
+    lock is saturated. A sharded queue keeps N independent environments in
+    sibling directories; publishers spread messages round-robin across the
+    shards and subscribers merge the shard heads by the monotonic message
+    ID, so the merged stream is still ordered by send time.
+
+    The same restrictions as for Environment apply per process: only one
+    sharded environment of each queue per process and no forking of the
+    environment or its components.
+
+    :ivar path: to the sharded queue
+    :vartype path: pathlib.Path
+    :ivar environments: one environment per shard
+    :vartype environments: List[persipubsub.environment.Environment]
+    """
+
+    def __init__(self,
+                 path: pathlib.Path,
+                 shard_num: Optional[int] = None,
+                 durability: Optional[
+                     persipubsub.queue.Durability] = None) -> None:
+        """
+        Initialize.
+
+        The number of shards is fixed when the queue is created; openers
+        without an explicit shard_num discover it from the existing shard
+        directories.
+
+        :param path: to the sharded queue
+        :param shard_num: number of shards; discovered when not given
+        :param durability: trades crash durability against write throughput
+        """
+        self.path = path
+        if not path.exists():
+            path.mkdir(parents=True, exist_ok=True)
+
+        if shard_num is None:
+            existing = sorted(
+                shard_dir for shard_dir in path.glob(SHARD_DIR_PREFIX + '*')
+                if shard_dir.is_dir())
+            shard_num = len(existing) if existing else DEFAULT_SHARD_NUM
+
+        self.environments = []  \
+            # type: List[persipubsub.environment.Environment]
+        for shard in range(shard_num):
+            shard_dir = path / "{}{}".format(SHARD_DIR_PREFIX, shard)
+            if not shard_dir.exists():
+                shard_dir.mkdir(parents=True, exist_ok=True)
+            self.environments.append(
+                persipubsub.environment.Environment(
+                    path=shard_dir, durability=durability))
+
+        self.closed = False
+
+    def __enter__(self) -> 'ShardedEnvironment':
+        """Enter the context and give environment prepared to constructor."""
+        return self
+
+    def __exit__(self, exc_type: Any, exc_val: Any, exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close all shard environments. Repeat calls have no effect."""
+        for env in self.environments:
+            if not env.closed:
+                env.close()
+        self.closed = True
+
+    @icontract.require(lambda self: not self.closed)
+    def new_control(self,
+                    subscriber_ids: Optional[Set[str]] = None,
+                    high_water_mark: persipubsub.queue.
+                    HighWaterMark = persipubsub.queue.HighWaterMark(),
+                    strategy: persipubsub.queue.Strategy = persipubsub.queue.
+                    Strategy.PRUNE_FIRST) -> 'ShardedControl':
+        """
+        Create a new control over all shards.
+
+        :param subscriber_ids: subscribers of the queue
+        :param high_water_mark: high water mark limit of every shard
+        :param strategy: used to prune every shard
+        :return: Control to create and maintain the sharded queue
+        """
+        return ShardedControl(controls=[
+            env.new_control(
+                subscriber_ids=subscriber_ids,
+                high_water_mark=high_water_mark,
+                strategy=strategy) for env in self.environments
+        ])
+
+    @icontract.require(lambda self: not self.closed)
+    def new_publisher(self,
+                      autosync: bool = False) -> 'ShardedPublisher':
+        """
+        Create a new publisher which spreads messages across the shards.
+
+        :param autosync: if True, store data automatically in LMDB
+        :return: Publisher to send messages
+        """
+        return ShardedPublisher(publishers=[
+            env.new_publisher(autosync=autosync)
+            for env in self.environments
+        ])
+
+    @icontract.require(lambda self: not self.closed)
+    def new_subscriber(self, identifier: str) -> 'ShardedSubscriber':
+        """
+        Create a new subscriber which merges the shard heads.
+
+        :param identifier: of the subscriber
+        :return: Subscriber to receive messages
+        """
+        return ShardedSubscriber(
+            identifier=identifier,
+            subscribers=[
+                env.new_subscriber(identifier=identifier)
+                for env in self.environments
+            ])
+
+
+class ShardedControl:
+    """
+    Control and maintain a sharded queue.
+
+    :ivar controls: one control per shard
+    :vartype controls: List[persipubsub.control.Control]
+    """
+
+    def __init__(self,
+                 controls: List[persipubsub.control.Control]) -> None:
+        """
+        Initialize.
+
+        :param controls: one control per shard
+        """
+        self.controls = controls
+        self.closed = False
+
+    def close(self) -> None:
+        """Close all shard controls."""
+        for control in self.controls:
+            control.close()
+        self.closed = True
+
+    @icontract.require(lambda self: not self.closed)
+    def prune_dangling_messages(self) -> None:
+        """Prune all dangling messages from all shards."""
+        for control in self.controls:
+            control.prune_dangling_messages()
+
+    @icontract.require(lambda self: not self.closed)
+    def clear_all_subscribers(self) -> None:
+        """Clear all subscriber and delete all messages on all shards."""
+        for control in self.controls:
+            control.clear_all_subscribers()
+
+
+class ShardedPublisher:
+    """
+    Send messages round-robin across the shards of a sharded queue.
+
+    The publisher is thread-safe; every shard still serializes its own
+    writers, but publishers on different shards commit in parallel.
+
+    :ivar publishers: one publisher per shard
+    :vartype publishers: List[persipubsub.publisher.Publisher]
+    """
+
+    def __init__(self,
+                 publishers: List[persipubsub.publisher.Publisher]) -> None:
+        """
+        Initialize.
+
+        :param publishers: one publisher per shard
+        """
+        self.publishers = publishers
+        self._next_shard = 0
+        self._lock = threading.Lock()
+        self.closed = False
+
+    def __enter__(self) -> 'ShardedPublisher':
+        """Enter the context and give the pub prepared in the constructor."""
+        return self
+
+    def __exit__(self, exc_type: Any, exc_val: Any, exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close all shard publishers."""
+        for pub in self.publishers:
+            pub.close()
+        self.closed = True
+
+    def _advance_shard(self, step: int = 1) -> int:
+        """
+        Pick the shard of the next message and advance the round-robin.
+
+        :param step: number of messages about to be sent
+        :return: index of the shard of the next message
+        """
+        with self._lock:
+            shard = self._next_shard
+            self._next_shard = (self._next_shard + step) % len(
+                self.publishers)
+        return shard
+
+    @icontract.require(lambda self: not self.closed)
+    def send(self, msg: bytes) -> None:
+        """
+        Write one message to the next shard in one transaction.
+
+        :param msg: to queue that all subscribers can read it
+        """
+        self.publishers[self._advance_shard()].send(msg=msg)
+
+    @icontract.require(lambda self: not self.closed)
+    def send_many(self, msgs: List[bytes]) -> None:
+        """
+        Write multiple messages spread across all shards.
+
+        Each shard receives its slice of the batch in one transaction.
+
+        :param msgs: to queue that all subscribers can read them
+        """
+        shard_num = len(self.publishers)
+        first_shard = self._advance_shard(step=len(msgs))
+        for offset in range(shard_num):
+            shard_msgs = msgs[offset::shard_num]
+            if shard_msgs:
+                self.publishers[(first_shard + offset) % shard_num].send_many(
+                    msgs=shard_msgs)
+
+
+class ShardedSubscriber:
+    """
+    Receive messages merged from all shards of a sharded queue.
+
+    The shard heads are merged by the monotonic message ID, so the merged
+    stream is ordered by send time across the shards.
+
+    :ivar identifier: subscriber ID
+    :vartype identifier: str
+    :ivar subscribers: one subscriber per shard
+    :vartype subscribers: List[persipubsub.subscriber.Subscriber]
+    """
+
+    def __init__(self, identifier: str,
+                 subscribers: List[persipubsub.subscriber.Subscriber]
+                 ) -> None:
+        """
+        Initialize.
+
+        :param identifier: of the subscriber
+        :param subscribers: one subscriber per shard
+        """
+        self.identifier = identifier
+        self.subscribers = subscribers
+        self.closed = False
+
+    def __enter__(self) -> 'ShardedSubscriber':
+        """Enter the context and give the sub prepared in the constructor."""
+        return self
+
+    def __exit__(self, exc_type: Any, exc_val: Any, exc_tb: Any) -> None:
+        """Leave the context."""
+        self.close()
+
+    def close(self) -> None:
+        """Close all shard subscribers."""
+        for sub in self.subscribers:
+            sub.close()
+        self.closed = True
+
+    @icontract.require(lambda timeout: timeout > 0)
+    @icontract.require(lambda retries: retries > 0)
+    @icontract.require(lambda self: not self.closed)
+    @contextlib.contextmanager
+    def receive(self, timeout: int = 60,
+                retries: int = 10) -> Iterator[Optional[bytes]]:
+        """
+        Receive the oldest message over all shards.
+
+        The shards are polled since a notification FIFO covers only its own
+        shard; the poll interval is timeout / retries as in
+        Subscriber.receive.
+
+        :param timeout:
+            time waiting for a message. If none arrived until the timeout
+            then None will be returned. (secs)
+        :param retries: number of tries to check if a msg arrived in the queue
+        :return:
+            Iterator because of decorator which contains a message in bytes
+        """
+        msg = None
+        msg_id = None
+        best_sub = None
+        end = int(datetime.datetime.utcnow().timestamp()) + timeout
+        try:
+            while int(datetime.datetime.utcnow().timestamp()) <= end:
+                for sub in self.subscribers:
+                    assert sub.queue is not None
+                    key, candidate = sub.queue.front(sub_id=self.identifier)
+                    if key is not None and (msg_id is None or key < msg_id):
+                        msg_id = key
+                        msg = candidate
+                        best_sub = sub
+
+                if msg is not None:
+                    break
+                time.sleep(timeout / retries)
+            yield msg
+        finally:
+            pass
+
+        if msg_id is not None:
+            assert best_sub is not None
+            assert best_sub.queue is not None
+            best_sub.queue.pop(sub_id=self.identifier, msg_id=msg_id)
@@ -4,30 +4,59 @@
 import contextlib
 import datetime
 import pathlib
-import time
-from typing import Any, Iterator, Optional, Union
+from typing import Any, Iterator, List, Optional, Tuple, Union
 
 import icontract
 import lmdb  # pylint: disable=unused-import
 
-import persipubsub.database
+import persipubsub.notification
 import persipubsub.queue
 
 # pylint: disable=protected-access
 
+#: Default number of acknowledged messages after which acks are flushed
+DEFAULT_ACK_INTERVAL_MSGS = 64  # type: int
+#: Default time after which acknowledged messages are flushed (secs)
+DEFAULT_ACK_INTERVAL_SECS = 1  # type: int
 
-def initialize(path: pathlib.Path, env: lmdb.Environment,
-               identifier: str) -> 'Subscriber':
+
+def initialize(path: pathlib.Path,
+               env: lmdb.Environment,
+               identifier: str,
+               deferred_ack: bool = False,
+               ack_interval_msgs: int = DEFAULT_ACK_INTERVAL_MSGS,
+               ack_interval_secs: int = DEFAULT_ACK_INTERVAL_SECS,
+               queue: Optional['persipubsub.queue._Queue'] = None
+               ) -> 'Subscriber':
     """
     Initialize a new subscriber.
 
     :param path: to LMDB
     :param env: open LMDB environment
     :param identifier: of the subscriber
+    :param deferred_ack:
+        if True, received messages are acknowledged in memory and popped in
+        batches instead of one write transaction per message
+    :param ack_interval_msgs:
+        number of acknowledged messages after which acks are flushed at the
+        latest
+    :param ack_interval_secs:
+        time after which acknowledged messages are flushed at the latest
+        (secs)
+    :param queue:
+        already initialized queue shared with other components; if None, the
+        subscriber initializes its own queue
     :return: Subscriber to receive messages
     """
     subscriber = Subscriber()
-    subscriber.init(identifier=identifier, path=path, env=env)
+    subscriber.init(
+        identifier=identifier,
+        path=path,
+        env=env,
+        deferred_ack=deferred_ack,
+        ack_interval_msgs=ack_interval_msgs,
+        ack_interval_secs=ack_interval_secs,
+        queue=queue)
     return subscriber
 
 
@@ -39,30 +68,77 @@ class Subscriber:
     :vartype pub_id: str
     :ivar queue: from which messages are received
     :vartype queue: persipubsub.queue.Queue
+    :ivar listener: blocks on the notification FIFO between polls
+    :vartype listener: persipubsub.notification.Listener
+    :ivar deferred_ack: if True, pops are batched instead of immediate
+    :vartype deferred_ack: bool
+    :ivar ack_interval_msgs:
+        number of acknowledged messages after which acks are flushed at the
+        latest
+    :vartype ack_interval_msgs: int
+    :ivar ack_interval_secs:
+        time after which acknowledged messages are flushed at the latest
+        (secs)
+    :vartype ack_interval_secs: int
     """
 
     def __init__(self) -> None:
         """Initialize class object."""
         self.identifier = None  # type: Optional[str]
         self.queue = None  # type: Optional[persipubsub.queue._Queue]
+        self.listener = None  \
+            # type: Optional[persipubsub.notification.Listener]
+        self.deferred_ack = False
+        self.ack_interval_msgs = DEFAULT_ACK_INTERVAL_MSGS  # type: int
+        self.ack_interval_secs = DEFAULT_ACK_INTERVAL_SECS  # type: int
+        self._pending_acks = []  # type: List[bytes]
+        self._last_flush_timestamp = 0.0  # type: float
         self.closed = False
 
     def init(self,
              identifier: str,
              path: Union[pathlib.Path, str],
-             env: Optional[lmdb.Environment] = None) -> None:
+             env: Optional[lmdb.Environment] = None,
+             deferred_ack: bool = False,
+             ack_interval_msgs: int = DEFAULT_ACK_INTERVAL_MSGS,
+             ack_interval_secs: int = DEFAULT_ACK_INTERVAL_SECS,
+             queue: Optional['persipubsub.queue._Queue'] = None) -> None:
         """
         Initialize.
 
         :param identifier: unique subscriber id
         :param path: path to the queue
         :param env: open LMDBenvironment
+        :param deferred_ack:
+            if True, received messages are acknowledged in memory and popped
+            in batches instead of one write transaction per message
+        :param ack_interval_msgs:
+            number of acknowledged messages after which acks are flushed at
+            the latest
+        :param ack_interval_secs:
+            time after which acknowledged messages are flushed at the latest
+            (secs)
+        :param queue:
+            already initialized queue shared with other components; if None,
+            the subscriber initializes its own queue
         """
+        # pylint: disable=too-many-arguments
         self.identifier = identifier
         assert self.identifier is not None
-        self.queue = persipubsub.queue._Queue()  # pylint: disable=protected-access
-        self.queue.init(path=path, env=env)
+        if queue is not None:
+            self.queue = queue
+        else:
+            self.queue = persipubsub.queue._Queue()  # pylint: disable=protected-access
+            self.queue.init(path=path, env=env)
         assert self.queue is not None
+        assert self.queue.path is not None
+        self.listener = persipubsub.notification.Listener(
+            queue_dir=self.queue.path, sub_id=identifier)
+        self.deferred_ack = deferred_ack
+        self.ack_interval_msgs = ack_interval_msgs
+        self.ack_interval_secs = ack_interval_secs
+        self._last_flush_timestamp = \
+            datetime.datetime.utcnow().timestamp()
 
     def __enter__(self) -> 'Subscriber':
         """Enter the context and give the sub prepared in the constructor."""
@@ -73,9 +149,47 @@ class Subscriber:
         self.close()
 
     def close(self) -> None:
-        """Close subscriber."""
+        """Close subscriber and flush outstanding acknowledgments."""
+        if not self.closed:
+            self.flush_acks()
+        if self.listener is not None:
+            self.listener.close()
         self.closed = True
 
+    @icontract.require(lambda self: not self.closed)
+    def flush_acks(self) -> None:
+        """
+        Pop all acknowledged messages in a single write transaction.
+
+        Without deferred acknowledgment there is nothing to flush and the
+        call has no effect.
+
+        :return:
+        """
+        if not self._pending_acks:
+            return
+
+        assert self.queue is not None
+        assert self.identifier is not None
+        self.queue.pop_many(
+            sub_id=self.identifier, msg_ids=self._pending_acks)
+        self._pending_acks = []
+        self._last_flush_timestamp = \
+            datetime.datetime.utcnow().timestamp()
+
+    def _ack(self, msg_id: bytes) -> None:
+        """
+        Mark a message acknowledged and flush when a threshold is reached.
+
+        :param msg_id: ID of the acknowledged message
+        """
+        self._pending_acks.append(msg_id)
+        timestamp_now = datetime.datetime.utcnow().timestamp()
+        if len(self._pending_acks) >= self.ack_interval_msgs \
+                or timestamp_now - self._last_flush_timestamp \
+                >= self.ack_interval_secs:
+            self.flush_acks()
+
     @icontract.require(lambda timeout: timeout > 0)
     @icontract.require(lambda retries: retries > 0)
     @icontract.require(lambda self: not self.closed)
@@ -97,18 +211,71 @@ class Subscriber:
         end = int(datetime.datetime.utcnow().timestamp()) + timeout
         assert self.queue is not None
         assert self.identifier is not None
+        # Messages acknowledged but not yet flushed are still in the
+        # subscriber database and need to be skipped.
+        after = self._pending_acks[-1] if self._pending_acks else None
         try:
             while int(datetime.datetime.utcnow().timestamp()) <= end:
-                msg_id, msg = self.queue.front(sub_id=self.identifier)
+                msg_id, msg = self.queue.front(
+                    sub_id=self.identifier, after=after)
                 if msg is not None:
                     break
-                time.sleep(timeout / retries)
+                assert self.listener is not None
+                self.listener.wait(timeout=timeout / retries)
             yield msg
         finally:
             pass
 
         if msg_id is not None:
-            self._pop(msg_id=msg_id)
+            if self.deferred_ack:
+                self._ack(msg_id=msg_id)
+            else:
+                self._pop(msg_id=msg_id)
+
+    @icontract.require(lambda max_msgs: max_msgs > 0)
+    @icontract.require(lambda timeout: timeout > 0)
+    @icontract.require(lambda retries: retries > 0)
+    @icontract.require(lambda self: not self.closed)
+    @contextlib.contextmanager
+    def receive_many(self,
+                     max_msgs: int = 64,
+                     timeout: int = 60,
+                     retries: int = 10) -> Iterator[List[bytes]]:
+        """
+        Receive up to max_msgs messages from the queue in one batch.
+
+        The messages are read in one read transaction and popped together
+        in one write transaction when the context is left, so draining a
+        backlog does not pay one transaction per message.
+
+        :param max_msgs: maximal number of messages received in the batch
+        :param timeout:
+            time waiting for a message. If none arrived until the timeout
+            then an empty list will be returned. (secs)
+        :param retries: number of tries to check if a msg arrived in the queue
+        :return:
+            Iterator because of decorator which contains the messages in
+            bytes, oldest message first
+        """
+        msgs = []  # type: List[Tuple[bytes, bytes]]
+        end = int(datetime.datetime.utcnow().timestamp()) + timeout
+        assert self.queue is not None
+        assert self.identifier is not None
+        try:
+            while int(datetime.datetime.utcnow().timestamp()) <= end:
+                msgs = self.queue.front_many(
+                    sub_id=self.identifier, max_msgs=max_msgs)
+                if msgs:
+                    break
+                assert self.listener is not None
+                self.listener.wait(timeout=timeout / retries)
+            yield [msg for _, msg in msgs]
+        finally:
+            pass
+
+        if msgs:
+            self.queue.pop_many(
+                sub_id=self.identifier, msg_ids=[key for key, _ in msgs])
 
     def _pop(self, msg_id: bytes) -> None:
         """Pop a message from the subscriber's database."""
@@ -140,19 +307,10 @@ class Subscriber:
             Iterator because of decorator which contains a message in bytes
         """
         assert self.queue is not None
-        assert self.queue.env is not None
         assert self.identifier is not None
-        with self.queue.env.begin(write=False) as txn:
-            sub_db = self.queue.env.open_db(
-                key=persipubsub.database.str_to_bytes(self.identifier),
-                txn=txn,
-                create=False)
-            sub_stat = txn.stat(db=sub_db)
-            # pop all message except the most recent one
-            msg_to_pop_num = sub_stat['entries'] - 1
-
-        for _ in range(msg_to_pop_num):
-            self.queue.pop(sub_id=self.identifier)
+        # pop all messages except the most recent one in a single write
+        # transaction
+        self.queue.pop_to_newest(sub_id=self.identifier)
 
         msg = None
         msg_id = None
@@ -162,7 +320,8 @@ class Subscriber:
                 msg_id, msg = self.queue.front(sub_id=self.identifier)
                 if msg is not None:
                     break
-                time.sleep(timeout / retries)
+                assert self.listener is not None
+                self.listener.wait(timeout=timeout / retries)
             yield msg
         finally:
             pass
@@ -0,0 +1,2 @@
+#!/usr/bin/env python
+"""Soak-test persipubsub under sustained multi-process load."""
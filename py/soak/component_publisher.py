@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+"""Publisher component for soak runs."""
+
+import json
+import pathlib
+import time
+from typing import List, Tuple  # pylint: disable=unused-import
+
+import persipubsub.database
+import persipubsub.environment
+
+#: Publisher index, sequence number and send timestamp, 8 bytes each,
+#: followed by a one-byte final flag.
+HEADER_SIZE = 25
+
+#: Marks the last message of a publisher; its sequence number equals the
+#: total number of messages which the publisher sent.
+FINAL_FLAG = b'\x01'
+
+NORMAL_FLAG = b'\x00'
+
+
+def pack_payload(pub_index: int, seq: int, msg_size: int,
+                 final: bool = False) -> bytes:
+    """
+    Build a soak payload with the verification header.
+
+    :param pub_index: index of the publisher within its queue
+    :param seq: sequence number of the message, starting at 1
+    :param msg_size: size of the payload in bytes, at least HEADER_SIZE
+    :param final: whether this is the last message of the publisher
+    :return: payload with the verification header and padding
+    """
+    timestamp_ns = int(time.time() * 10**9)
+    header = (persipubsub.database.int_to_bytes(value=pub_index) +
+              persipubsub.database.int_to_bytes(value=seq) +
+              persipubsub.database.int_to_bytes(value=timestamp_ns) +
+              (FINAL_FLAG if final else NORMAL_FLAG))
+    return header + b'\x00' * (msg_size - HEADER_SIZE)
+
+
+def unpack_header(msg: bytes) -> Tuple[int, int, int, bool]:
+    """
+    Parse the verification header of a soak payload.
+
+    :param msg: payload as built by pack_payload
+    :return:
+        publisher index, sequence number, send timestamp in nanoseconds
+        and whether the message is the last one of the publisher
+    """
+    return (persipubsub.database.bytes_to_int(array_of_bytes=msg[:8]),
+            persipubsub.database.bytes_to_int(array_of_bytes=msg[8:16]),
+            persipubsub.database.bytes_to_int(array_of_bytes=msg[16:24]),
+            msg[24:25] == FINAL_FLAG)
+
+
+# pylint: disable=too-many-arguments
+def send_process(path: pathlib.Path, result_path: pathlib.Path,
+                 pub_index: int, rate: float, duration: float,
+                 msg_size: int) -> None:
+    """
+    Send sequence-numbered messages at the target rate for the duration.
+
+    The last message carries the final flag and hence the total count of
+    this publisher, so that subscribers can verify that no message was
+    lost.
+
+    :param path: to the queue
+    :param result_path: file to which the publish statistics are written
+    :param pub_index: index of the publisher within its queue
+    :param rate: target messages per second
+    :param duration: of the run in seconds
+    :param msg_size: size of each message in bytes, at least HEADER_SIZE
+    """
+    env = persipubsub.environment.Environment(path=path)
+    pub = env.new_publisher()
+
+    interval_sent = []  # type: List[int]
+    start = time.time()
+    seq = 0
+    while time.time() - start < duration:
+        seq += 1
+        pub.send(
+            msg=pack_payload(pub_index=pub_index, seq=seq, msg_size=msg_size))
+
+        interval = int(time.time() - start)
+        while len(interval_sent) <= interval:
+            interval_sent.append(0)
+        interval_sent[interval] += 1
+
+        # Pace against the planned schedule instead of sleeping a fixed
+        # delay, so that short stalls are caught up and the rate holds on
+        # average.
+        delay = start + seq / rate - time.time()
+        if delay > 0:
+            time.sleep(delay)
+
+    seq += 1
+    pub.send(
+        msg=pack_payload(
+            pub_index=pub_index, seq=seq, msg_size=msg_size, final=True))
+
+    result_path.write_text(
+        json.dumps({
+            'pub_index': pub_index,
+            'sent': seq,
+            'duration': time.time() - start,
+            'interval_sent': interval_sent
+        }))
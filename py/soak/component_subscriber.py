@@ -0,0 +1,126 @@
+#!/usr/bin/env python
+"""Subscriber component for soak runs."""
+
+import json
+import pathlib
+import time
+from typing import (  # pylint: disable=unused-import
+    List, MutableMapping, Sequence, Set)
+
+import persipubsub.environment
+import persipubsub.metrics
+
+import soak.component_publisher
+
+
+def quantile_ms(buckets: Sequence[int], count: int, quantile: float) -> float:
+    """
+    Approximate a latency quantile from power-of-two buckets.
+
+    The returned value is the upper bound of the bucket in which the
+    requested quantile falls, in milliseconds.
+
+    :param buckets: per-bucket counts as in persipubsub.metrics.Histogram
+    :param count: total number of recorded durations
+    :param quantile: requested quantile, e.g. 0.99
+    :return: upper bound of the quantile bucket in milliseconds
+    """
+    if count == 0:
+        return 0.0
+
+    rank = quantile * count
+    cumulative = 0
+    for index, value in enumerate(buckets):
+        cumulative += value
+        if cumulative >= rank:
+            return 2**index / 10**6
+
+    return 2**(len(buckets) - 1) / 10**6
+
+
+# pylint: disable=too-many-arguments
+# pylint: disable=too-many-locals
+def receive_process(path: pathlib.Path,
+                    result_path: pathlib.Path,
+                    identifier: str,
+                    pub_count: int,
+                    timeout: int = 2,
+                    retries: int = 10,
+                    method_timeout: float = 300) -> None:
+    """
+    Receive soak messages and verify the ordering and no-loss invariants.
+
+    Every publisher numbers its messages sequentially, so per publisher
+    the sequence numbers must arrive in order and without gaps; a
+    violation raises and thereby fails the soak run. The process ends
+    once the final message of all pub_count publishers arrived.
+
+    :param path: to the queue
+    :param result_path: file to which the receive statistics are written
+    :param identifier: of the subscriber
+    :param pub_count: number of publishers which feed the queue
+    :param timeout: time waiting for a message in seconds
+    :param retries: number of tries to check if a message arrived
+    :param method_timeout: time after which the soak run fails (secs)
+    """
+    env = persipubsub.environment.Environment(path=path)
+    sub = env.new_subscriber(identifier=identifier)
+
+    last_seq = {}  # type: MutableMapping[int, int]
+    finished = set()  # type: Set[int]
+    received = 0
+    overall = persipubsub.metrics.Histogram()
+    interval_received = []  # type: List[int]
+    interval_histograms = []  # type: List[persipubsub.metrics.Histogram]
+
+    start = time.time()
+    while len(finished) < pub_count:
+        if time.time() - start >= method_timeout:
+            raise TimeoutError
+
+        with sub.receive(timeout=timeout, retries=retries) as msg:
+            if msg is None:
+                continue
+
+            now = time.time()
+            pub_index, seq, timestamp_ns, final = \
+                soak.component_publisher.unpack_header(msg=msg)
+
+            expected = last_seq.get(pub_index, 0) + 1
+            if seq != expected:
+                raise RuntimeError(
+                    "Ordering or loss violation for publisher {}: "
+                    "expected sequence number {}, got {}".format(
+                        pub_index, expected, seq))
+
+            last_seq[pub_index] = seq
+            if final:
+                finished.add(pub_index)
+
+            received += 1
+            latency = now - timestamp_ns / 10**9
+            overall.record(duration=latency)
+
+            interval = int(now - start)
+            while len(interval_received) <= interval:
+                interval_received.append(0)
+                interval_histograms.append(persipubsub.metrics.Histogram())
+            interval_received[interval] += 1
+            interval_histograms[interval].record(duration=latency)
+
+    result_path.write_text(
+        json.dumps({
+            'identifier': identifier,
+            'received': received,
+            'duration': time.time() - start,
+            'latency_count': overall.count,
+            'latency_sum_ns': overall.sum_ns,
+            'latency_buckets': overall.buckets,
+            'interval_received': interval_received,
+            'interval_latency_p99_ms': [
+                quantile_ms(
+                    buckets=histogram.buckets,
+                    count=histogram.count,
+                    quantile=0.99) for histogram in interval_histograms
+            ]
+        }))
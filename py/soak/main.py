@@ -0,0 +1,273 @@
+#!/usr/bin/env python
+"""Soak-test persipubsub with multi-process topologies and regression gates."""
+
+import argparse
+import json
+import multiprocessing
+import pathlib
+import sys
+import tempfile
+from typing import Any, List, Mapping, MutableMapping  # pylint: disable=unused-import
+
+import persipubsub.environment
+import persipubsub.metrics
+import persipubsub.queue
+
+import soak.component_publisher
+import soak.component_subscriber
+
+#: Metrics which are compared against the stored baseline.
+GATED_METRICS = [
+    'send_msgs_per_sec', 'receive_msgs_per_sec', 'latency_p99_ms',
+    'worst_interval_latency_p99_ms'
+]  # type: List[str]
+
+#: Gated metrics for which a higher measured value is a regression.
+HIGHER_IS_WORSE = {'latency_p99_ms', 'worst_interval_latency_p99_ms'}
+
+
+# pylint: disable=too-many-arguments
+# pylint: disable=too-many-locals
+def run_topology(queue_count: int, pub_count: int, sub_count: int,
+                 rate: float, duration: float,
+                 msg_size: int) -> MutableMapping[str, Any]:
+    """
+    Run one soak topology of queues x publishers x subscribers.
+
+    Every queue runs in its own directory with pub_count publisher and
+    sub_count subscriber processes; each process opens its own
+    environment, so the run exercises the cross-process LMDB locking,
+    pruning and map-resize behaviour under sustained load. The
+    subscribers verify the ordering and no-loss invariants continuously
+    and fail the run on a violation.
+
+    :param queue_count: number of independent queues
+    :param pub_count: number of publisher processes per queue
+    :param sub_count: number of subscriber processes per queue
+    :param rate: target messages per second per publisher
+    :param duration: of the run in seconds
+    :param msg_size: size of each message in bytes
+    :return: aggregated throughput and latency metrics
+    """
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        expected_per_pub = int(rate * duration) + 1
+        hwm = persipubsub.queue.HighWaterMark(
+            max_messages=2 * pub_count * expected_per_pub)
+
+        processes = []  # type: List[multiprocessing.Process]
+        pub_result_paths = []  # type: List[pathlib.Path]
+        sub_result_paths = []  # type: List[pathlib.Path]
+        for queue_index in range(queue_count):
+            queue_dir = pathlib.Path(tmp_dir) / "queue{}".format(queue_index)
+            queue_dir.mkdir()
+
+            sub_ids = ["sub{}".format(index) for index in range(sub_count)]
+            env = persipubsub.environment.Environment(path=queue_dir)
+            _ = env.new_control(
+                subscriber_ids=set(sub_ids), high_water_mark=hwm)
+            env.close()
+
+            for pub_index in range(pub_count):
+                result_path = pathlib.Path(tmp_dir) / "queue{}-pub{}.json" \
+                    .format(queue_index, pub_index)
+                pub_result_paths.append(result_path)
+                processes.append(
+                    multiprocessing.Process(
+                        target=soak.component_publisher.send_process,
+                        kwargs={
+                            'path': queue_dir,
+                            'result_path': result_path,
+                            'pub_index': pub_index,
+                            'rate': rate,
+                            'duration': duration,
+                            'msg_size': msg_size
+                        }))
+
+            for sub_id in sub_ids:
+                result_path = pathlib.Path(tmp_dir) / "queue{}-{}.json" \
+                    .format(queue_index, sub_id)
+                sub_result_paths.append(result_path)
+                processes.append(
+                    multiprocessing.Process(
+                        target=soak.component_subscriber.receive_process,
+                        kwargs={
+                            'path': queue_dir,
+                            'result_path': result_path,
+                            'identifier': sub_id,
+                            'pub_count': pub_count,
+                            'method_timeout': duration + 60
+                        }))
+
+        for process in processes:
+            process.start()
+
+        for process in processes:
+            process.join()
+            if process.exitcode != 0:
+                raise RuntimeError(
+                    "Soak process failed with exit code {}".format(
+                        process.exitcode))
+
+        sent = 0
+        pub_duration = 0.0
+        for result_path in pub_result_paths:
+            result = json.loads(result_path.read_text())
+            sent += result['sent']
+            pub_duration = max(pub_duration, result['duration'])
+
+        received = 0
+        sub_duration = 0.0
+        latency_count = 0
+        latency_sum_ns = 0
+        latency_buckets = [0] * persipubsub.metrics.BUCKET_NUM
+        worst_interval_p99 = 0.0
+        for result_path in sub_result_paths:
+            result = json.loads(result_path.read_text())
+            received += result['received']
+            sub_duration = max(sub_duration, result['duration'])
+            latency_count += result['latency_count']
+            latency_sum_ns += result['latency_sum_ns']
+            for index, value in enumerate(result['latency_buckets']):
+                latency_buckets[index] += value
+            if result['interval_latency_p99_ms']:
+                worst_interval_p99 = max(
+                    worst_interval_p99, max(result['interval_latency_p99_ms']))
+
+        report = {
+            'queues': queue_count,
+            'publishers': pub_count,
+            'subscribers': sub_count,
+            'rate': rate,
+            'duration': duration,
+            'msg_size': msg_size,
+            'sent': sent,
+            'received': received,
+            'send_msgs_per_sec': sent / pub_duration,
+            'receive_msgs_per_sec': received / sub_duration,
+            'latency_p50_ms': soak.component_subscriber.quantile_ms(
+                buckets=latency_buckets, count=latency_count, quantile=0.5),
+            'latency_p99_ms': soak.component_subscriber.quantile_ms(
+                buckets=latency_buckets, count=latency_count, quantile=0.99),
+            'worst_interval_latency_p99_ms': worst_interval_p99
+        }  # type: MutableMapping[str, Any]
+
+        return report
+
+
+def check_against_baseline(report: Mapping[str, Any],
+                           baseline: Mapping[str, Any],
+                           threshold: float) -> List[str]:
+    """
+    Compare the gated metrics of a report against a stored baseline.
+
+    :param report: of the current run
+    :param baseline: previously stored gated metrics
+    :param threshold: tolerated relative regression, e.g. 0.2 for 20%
+    :return: description of every violated gate; empty if none
+    """
+    violations = []  # type: List[str]
+    for metric in GATED_METRICS:
+        if metric not in baseline:
+            continue
+
+        base = baseline[metric]
+        measured = report[metric]
+        if metric in HIGHER_IS_WORSE:
+            if base > 0 and measured > base * (1 + threshold):
+                violations.append(
+                    "{}: {:.3f} exceeds the baseline {:.3f} by more "
+                    "than {:.0%}".format(metric, measured, base, threshold))
+        else:
+            if measured < base * (1 - threshold):
+                violations.append(
+                    "{}: {:.3f} fell below the baseline {:.3f} by more "
+                    "than {:.0%}".format(metric, measured, base, threshold))
+
+    return violations
+
+
+def main() -> int:
+    """Execute the soak run given on the command line."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        "--queues", type=int, default=1, help="number of independent queues")
+    parser.add_argument(
+        "--publishers",
+        type=int,
+        default=2,
+        help="number of publisher processes per queue")
+    parser.add_argument(
+        "--subscribers",
+        type=int,
+        default=2,
+        help="number of subscriber processes per queue")
+    parser.add_argument(
+        "--rate",
+        type=float,
+        default=100.0,
+        help="target messages per second per publisher")
+    parser.add_argument(
+        "--duration",
+        type=float,
+        default=60.0,
+        help="duration of the run in seconds")
+    parser.add_argument(
+        "--msg_size",
+        type=int,
+        default=64,
+        help="size of each message in bytes, at least {}".format(
+            soak.component_publisher.HEADER_SIZE))
+    parser.add_argument(
+        "--baseline",
+        help="JSON file with the gated metrics of a previous run; "
+        "the run fails on a regression beyond the threshold")
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=0.2,
+        help="tolerated relative regression against the baseline")
+    parser.add_argument(
+        "--update_baseline",
+        action='store_true',
+        help="write the gated metrics of this run to the baseline file")
+    parser.add_argument(
+        "--output", help="file for the report; defaults to standard output")
+
+    args = parser.parse_args()
+
+    report = run_topology(
+        queue_count=args.queues,
+        pub_count=args.publishers,
+        sub_count=args.subscribers,
+        rate=args.rate,
+        duration=args.duration,
+        msg_size=args.msg_size)
+
+    text = json.dumps(report, sort_keys=True) + '\n'
+    if args.output is None:
+        sys.stdout.write(text)
+    else:
+        pathlib.Path(args.output).write_text(text)
+
+    if args.baseline is not None:
+        baseline_path = pathlib.Path(args.baseline)
+        if args.update_baseline or not baseline_path.exists():
+            baseline_path.write_text(
+                json.dumps(
+                    {metric: report[metric]
+                     for metric in GATED_METRICS},
+                    sort_keys=True) + '\n')
+        else:
+            baseline = json.loads(baseline_path.read_text())
+            violations = check_against_baseline(
+                report=report, baseline=baseline, threshold=args.threshold)
+            if violations:
+                for violation in violations:
+                    sys.stderr.write(violation + '\n')
+                return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
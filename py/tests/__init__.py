@@ -8,7 +8,9 @@ import temppathlib
 
 import persipubsub
 # pylint: disable=missing-docstring
+# pylint: disable=protected-access
 import persipubsub.database
+import persipubsub.queue
 
 LMDB_PAGE_SIZE = 4096
 
@@ -33,6 +35,20 @@ QUEUE_DB = "queue_db".encode(ENCODING)  # queue_pth | all queue data
 SUBSCRIBER_DB = "subscriber_db".encode(ENCODING)  # sub_id | -
 
 
+def count_data_entries(queue: persipubsub.queue._Queue) -> int:
+    """Count the messages over all data segment databases of a queue."""
+    assert queue.env is not None
+    total = 0
+    with queue.env.begin(write=False) as txn:
+        for segment in queue._existing_data_segments(txn=txn):
+            seg_db = queue._segment_db(segment=segment, create=False)
+            total += txn.stat(db=seg_db)['entries']
+
+        total += txn.stat(db=queue.data_db)['entries']
+
+    return total
+
+
 class TestPersiPubSub(unittest.TestCase):
     def test_get_data(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
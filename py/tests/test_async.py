@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+"""Test async publisher and subscriber."""
+
+import asyncio
+import unittest
+from typing import Optional, Set
+
+import temppathlib
+
+import persipubsub.control
+import persipubsub.environment
+import persipubsub.queue
+import tests
+
+# pylint: disable=missing-docstring
+# pylint: disable=protected-access
+
+
+def setup(env: persipubsub.environment.Environment,
+          sub_set: Set[str]) -> persipubsub.control.Control:
+    """Create an initialized control"""
+    hwm = persipubsub.queue.HighWaterMark()
+    strategy = persipubsub.queue.Strategy.PRUNE_FIRST
+
+    control = env.new_control(
+        subscriber_ids=sub_set, high_water_mark=hwm, strategy=strategy)
+
+    return control
+
+
+class TestAsync(unittest.TestCase):
+    def setUp(self) -> None:
+        self.loop = asyncio.new_event_loop()
+
+    def tearDown(self) -> None:
+        self.loop.close()
+
+    def test_send(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_async_publisher(loop=self.loop)
+
+            msg = "Hello world!".encode(tests.ENCODING)
+            self.loop.run_until_complete(pub.send(msg=msg))
+
+            assert pub.publisher is not None
+            assert pub.publisher.queue is not None
+            self.assertEqual(1, pub.publisher.queue.count_msgs())
+
+    def test_send_many(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_async_publisher(loop=self.loop)
+
+            msg = "I'm a message".encode(tests.ENCODING)
+            msg_num = 10
+            self.loop.run_until_complete(
+                pub.send_many(msgs=[msg] * msg_num))
+
+            assert pub.publisher is not None
+            assert pub.publisher.queue is not None
+            self.assertEqual(msg_num, pub.publisher.queue.count_msgs())
+
+    def test_receive(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_async_publisher(loop=self.loop)
+            sub = env.new_async_subscriber(identifier='sub', loop=self.loop)
+
+            msg = "Hello world!".encode(tests.ENCODING)
+
+            async def send_and_receive() -> Optional[bytes]:
+                await pub.send(msg=msg)
+                async with sub.receive(timeout=2) as received_msg:
+                    return received_msg
+
+            received_msg = self.loop.run_until_complete(send_and_receive())
+            self.assertEqual(msg, received_msg)
+
+            # The message was popped when the context was left.
+            assert sub.subscriber is not None
+            assert sub.subscriber.queue is not None
+            _, pending_msg = sub.subscriber.queue.front(sub_id='sub')
+            self.assertIsNone(pending_msg)
+
+            sub.close()
+
+    def test_receive_timeout(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            sub = env.new_async_subscriber(identifier='sub', loop=self.loop)
+
+            async def receive() -> Optional[bytes]:
+                async with sub.receive(timeout=1, retries=2) as received_msg:
+                    return received_msg
+
+            received_msg = self.loop.run_until_complete(receive())
+            self.assertIsNone(received_msg)
+
+            sub.close()
+
+
+if __name__ == '__main__':
+    unittest.main()
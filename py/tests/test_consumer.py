@@ -0,0 +1,159 @@
+#!/usr/bin/env python
+"""Test consumer."""
+
+import unittest
+
+import temppathlib
+
+import persipubsub.control
+import persipubsub.environment
+import persipubsub.queue
+import tests
+
+# pylint: disable=missing-docstring
+# pylint: disable=protected-access
+
+
+def setup(env: persipubsub.environment.Environment,
+          group_id: str) -> persipubsub.control.Control:
+    """Create an initialized control with one consumer group"""
+    hwm = persipubsub.queue.HighWaterMark()
+    strategy = persipubsub.queue.Strategy.PRUNE_FIRST
+
+    control = env.new_control(
+        subscriber_ids=set(), high_water_mark=hwm, strategy=strategy)
+    control.add_consumer_group(group_id=group_id)
+
+    return control
+
+
+class TestConsumer(unittest.TestCase):
+    def test_claim_is_exclusive(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            msg = "work item".encode(tests.ENCODING)
+            pub.send(msg=msg)
+
+            first = env.new_consumer(group_id='workers', owner_id='worker-1')
+            second = env.new_consumer(group_id='workers', owner_id='worker-2')
+
+            msg_id, claimed_msg = first.claim()
+            self.assertIsNotNone(msg_id)
+            self.assertEqual(msg, claimed_msg)
+
+            # The message is leased and hence not claimable by another
+            # consumer of the group.
+            other_msg_id, other_msg = second.claim()
+            self.assertIsNone(other_msg_id)
+            self.assertIsNone(other_msg)
+
+    def test_ack_removes_message(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            pub.send(msg="work item".encode(tests.ENCODING))
+
+            consumer = env.new_consumer(
+                group_id='workers', owner_id='worker-1')
+
+            msg_id, _ = consumer.claim()
+            assert msg_id is not None
+            consumer.ack(msg_id=msg_id)
+
+            msg_id, claimed_msg = consumer.claim()
+            self.assertIsNone(msg_id)
+            self.assertIsNone(claimed_msg)
+
+    def test_expired_lease_is_claimable(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            msg = "work item".encode(tests.ENCODING)
+            pub.send(msg=msg)
+
+            # A lease timeout of 0 seconds expires immediately.
+            first = env.new_consumer(
+                group_id='workers', owner_id='worker-1', lease_timeout=0)
+            second = env.new_consumer(group_id='workers', owner_id='worker-2')
+
+            msg_id, _ = first.claim()
+            self.assertIsNotNone(msg_id)
+
+            other_msg_id, other_msg = second.claim()
+            self.assertEqual(msg_id, other_msg_id)
+            self.assertEqual(msg, other_msg)
+
+    def test_release(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            pub.send(msg="work item".encode(tests.ENCODING))
+
+            first = env.new_consumer(group_id='workers', owner_id='worker-1')
+            second = env.new_consumer(group_id='workers', owner_id='worker-2')
+
+            msg_id, _ = first.claim()
+            assert msg_id is not None
+            first.release(msg_id=msg_id)
+
+            other_msg_id, _ = second.claim()
+            self.assertEqual(msg_id, other_msg_id)
+
+    def test_receive(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            msg = "work item".encode(tests.ENCODING)
+            pub.send(msg=msg)
+
+            consumer = env.new_consumer(
+                group_id='workers', owner_id='worker-1')
+
+            with consumer.receive(timeout=2) as received_msg:
+                self.assertEqual(msg, received_msg)
+
+            # The message was acknowledged when the context was left.
+            msg_id, claimed_msg = consumer.claim()
+            self.assertIsNone(msg_id)
+            self.assertIsNone(claimed_msg)
+
+    def test_receive_releases_on_exception(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, group_id='workers')
+
+            pub = env.new_publisher()
+            msg = "work item".encode(tests.ENCODING)
+            pub.send(msg=msg)
+
+            consumer = env.new_consumer(
+                group_id='workers', owner_id='worker-1')
+
+            class ProcessingError(Exception):
+                pass
+
+            try:
+                with consumer.receive(timeout=2):
+                    raise ProcessingError()
+            except ProcessingError:
+                pass
+
+            # The claim was released, so the message can be claimed again.
+            msg_id, claimed_msg = consumer.claim()
+            self.assertIsNotNone(msg_id)
+            self.assertEqual(msg, claimed_msg)
+
+
+if __name__ == '__main__':
+    unittest.main()
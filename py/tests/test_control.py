@@ -11,6 +11,7 @@ import temppathlib
 import persipubsub.control
 import persipubsub.database
 import persipubsub.environment
+import persipubsub.metrics
 import persipubsub.queue
 import tests
 
@@ -31,8 +32,8 @@ class TestControl(unittest.TestCase):
             control = setup(path=tmp_dir.path, sub_set={'sub'})
 
             expected_db_keys = [
-                b'data_db', b'meta_db', b'pending_db', b'queue_db',
-                b'subscriber_db', b'sub'
+                b'ack_db', b'cursor_db', b'data_db', b'meta_db', b'pending_db',
+                b'queue_db', b'subscriber_db', b'zero_pending_db', b'sub'
             ]
             db_keys = []  # type: List[bytes]
 
@@ -56,8 +57,8 @@ class TestControl(unittest.TestCase):
             control._remove_sub(sub_id="sub2")
 
             expected_db_keys = [
-                b'data_db', b'meta_db', b'pending_db', b'queue_db',
-                b'subscriber_db', b'sub1'
+                b'ack_db', b'cursor_db', b'data_db', b'meta_db', b'pending_db',
+                b'queue_db', b'subscriber_db', b'zero_pending_db', b'sub1'
             ]
             db_keys = []  # type: List[bytes]
 
@@ -76,8 +77,8 @@ class TestControl(unittest.TestCase):
             control.clear_all_subscribers()
 
             expected_db_keys = [
-                b'data_db', b'meta_db', b'pending_db', b'queue_db',
-                b'subscriber_db'
+                b'ack_db', b'cursor_db', b'data_db', b'meta_db', b'pending_db',
+                b'queue_db', b'subscriber_db', b'zero_pending_db'
             ]
             db_keys = []  # type: List[bytes]
 
@@ -143,6 +144,12 @@ class TestControl(unittest.TestCase):
                         length=tests.BYTES_LENGTH, byteorder=tests.BYTES_ORDER),
                     db=pending_db)
 
+                # Fully consumed messages are indexed in the zero-pending
+                # database.
+                txn.put(
+                    key="popped_msg".encode(tests.ENCODING),
+                    db=control.queue.zero_pending_db)
+
             with control.queue.env.begin(write=True) as txn:
                 meta_db = control.queue.env.open_db(
                     key=tests.META_DB, txn=txn, create=False)
@@ -229,6 +236,52 @@ class TestControl(unittest.TestCase):
             self.assertTrue(control.is_initialized())
             control._remove_sub("sub2")
 
+    def test_metrics(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            control = setup(path=tmp_dir.path, sub_set={'sub'})
+
+            assert control.queue is not None
+            msg = "metrics message".encode(tests.ENCODING)
+            control.queue.put(msg=msg)
+            control.queue.pop(sub_id='sub')
+
+            snapshot = control.metrics()
+
+            self.assertEqual(1, snapshot['counters']['msgs_put'])
+            self.assertEqual(1, snapshot['counters']['msgs_popped'])
+            self.assertEqual(1, snapshot['latencies']['put']['count'])
+            self.assertEqual(1, snapshot['latencies']['pop']['count'])
+            self.assertEqual(1, snapshot['num_msgs'])
+            self.assertEqual(len(msg), snapshot['data_size_bytes'])
+
+            text = persipubsub.metrics.format_prometheus(snapshot=snapshot)
+            self.assertIn('persipubsub_msgs_put_total 1', text)
+            self.assertIn('persipubsub_num_msgs 1', text)
+
+    def test_residency_sampling(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            control = setup(path=tmp_dir.path, sub_set={'sub'})
+
+            control.set_residency_sampling(sample_interval=1)
+
+            assert control.queue is not None
+            control.queue.put(msg="sampled message".encode(tests.ENCODING))
+            control.queue.pop(sub_id='sub')
+
+            snapshot = control.metrics()
+            self.assertEqual(1, snapshot['residencies']['sub']['count'])
+
+            text = persipubsub.metrics.format_prometheus(snapshot=snapshot)
+            self.assertIn('persipubsub_residency_seconds_count'
+                          '{subscriber="sub"} 1', text)
+
+            control.set_residency_sampling(sample_interval=None)
+            control.queue.put(msg="unsampled message".encode(tests.ENCODING))
+            control.queue.pop(sub_id='sub')
+
+            snapshot = control.metrics()
+            self.assertEqual(1, snapshot['residencies']['sub']['count'])
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -6,6 +6,7 @@ import unittest
 import temppathlib
 
 import persipubsub.control
+import persipubsub.database
 import persipubsub.environment
 import persipubsub.publisher
 import persipubsub.queue
@@ -43,6 +44,88 @@ class TestEnvironment(unittest.TestCase):
             sub = env.new_subscriber(identifier="sub")
             self.assertIsInstance(sub, persipubsub.subscriber.Subscriber)
 
+    def test_components_share_queue(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.initialize(path=tmp_dir.path)
+            ctl = env.new_control(subscriber_ids={'sub'})
+            pub = env.new_publisher()
+            sub = env.new_subscriber(identifier='sub')
+
+            self.assertIs(ctl.queue, pub.queue)
+            self.assertIs(pub.queue, sub.queue)
+
+    def test_subscription_change_reaches_shared_queue(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.initialize(path=tmp_dir.path)
+            ctl = env.new_control(subscriber_ids={'sub'})
+            pub = env.new_publisher()
+            sub = env.new_subscriber(identifier='sub')
+
+            ctl.set_subscription(sub_id='sub', topic_pattern='metrics.*')
+
+            # The publisher shares the queue with the control and hence
+            # routes by the changed subscription without a new environment.
+            pub.send(msg="app log".encode('utf-8'), topic='logs.app')
+            pub.send(msg="cpu load".encode('utf-8'), topic='metrics.cpu')
+
+            with sub.receive(timeout=2) as received:
+                self.assertEqual("cpu load".encode('utf-8'), received)
+
+    def test_compact(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.initialize(path=tmp_dir.path)
+            _ = env.new_control(subscriber_ids={'sub'})
+            pub = env.new_publisher()
+            sub = env.new_subscriber(identifier='sub')
+
+            msg = "before compaction".encode('utf-8')
+            pub.send(msg=msg)
+
+            env.compact()
+
+            # The components created before the compaction were re-attached
+            # and keep working on the compacted file; the send comes first
+            # so that the write path runs on the re-attached handles before
+            # any read could refresh them.
+            new_msg = "after compaction".encode('utf-8')
+            pub.send(msg=new_msg)
+
+            with sub.receive(timeout=2) as received:
+                self.assertEqual(msg, received)
+            with sub.receive(timeout=2) as received:
+                self.assertEqual(new_msg, received)
+
+            self.assertFalse(
+                (tmp_dir.path / persipubsub.database.COMPACT_DIR).exists())
+
+    def test_default_durability(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.initialize(path=tmp_dir.path)
+            _ = env.new_control()
+            self.assertEqual(persipubsub.queue.Durability.STRICT,
+                             env.durability)
+            self.assertEqual(
+                'STRICT',
+                persipubsub.database.retrieve_durability(env=env._env))
+
+    def test_durability_recorded_and_recovered(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.initialize(
+                path=tmp_dir.path,
+                durability=persipubsub.queue.Durability.RELAXED)
+            _ = env.new_control()
+            self.assertEqual(
+                'RELAXED',
+                persipubsub.database.retrieve_durability(env=env._env))
+            env.close()
+
+            # A process which opens the queue without an explicit profile
+            # picks up the recorded one.
+            reopened = persipubsub.environment.initialize(path=tmp_dir.path)
+            self.assertEqual(persipubsub.queue.Durability.RELAXED,
+                             reopened.durability)
+            reopened.close()
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -434,10 +434,6 @@ class TestLive(unittest.TestCase):
                     key='sub'.encode('utf-8'), txn=txn)
                 self.assertEqual(num_processes * num_msg,
                                  txn.stat(db=sub_db)['entries'])
-                data_db = control.queue.env.open_db(
-                    key=persipubsub.database.DATA_DB, txn=txn)
-                self.assertEqual(num_processes * num_msg,
-                                 txn.stat(db=data_db)['entries'])
                 meta_db = control.queue.env.open_db(
                     key=persipubsub.database.META_DB, txn=txn)
                 self.assertEqual(num_processes * num_msg,
@@ -447,6 +443,9 @@ class TestLive(unittest.TestCase):
                 self.assertEqual(num_processes * num_msg,
                                  txn.stat(db=pending_db)['entries'])
 
+            self.assertEqual(num_processes * num_msg,
+                             tests.count_data_entries(queue=control.queue))
+
     def test_2_subscriber_non_blocking(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             env = persipubsub.environment.initialize(path=tmp_dir.path)
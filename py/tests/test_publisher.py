@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 """Test publisher."""
 
+import threading
 import unittest
 from typing import Set
 
@@ -49,9 +50,8 @@ class TestPublisher(unittest.TestCase):
 
                 key = cursor.key()
 
-                data_db = env._env.open_db(
-                    key=tests.DATA_DB, txn=txn, create=False)
-                item = txn.get(key=key, db=data_db)
+                assert pub.queue is not None
+                item = pub.queue._get_data(txn=txn, key=key)
                 self.assertIsNotNone(item)
                 self.assertEqual(msg, item)
 
@@ -86,11 +86,120 @@ class TestPublisher(unittest.TestCase):
                 sub_stat = txn.stat(db=sub_db)
                 self.assertEqual(msg_num, sub_stat['entries'])
 
-                data_db = pub.queue.env.open_db(
-                    key=tests.DATA_DB, txn=txn, create=False)
+            self.assertEqual(msg_num,
+                             tests.count_data_entries(queue=pub.queue))
 
-                data_stat = txn.stat(db=data_db)
-                self.assertEqual(msg_num, data_stat['entries'])
+    def test_send_many_streams_iterator(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_publisher(max_batch_msgs=3)
+
+            msg_num = 10
+            msgs = ("message {}".format(index).encode(tests.ENCODING)
+                    for index in range(msg_num))
+
+            pub.send_many(msgs=msgs)
+
+            assert pub.queue is not None
+            self.assertEqual(msg_num,
+                             tests.count_data_entries(queue=pub.queue))
+
+    def test_send_stream_yields_progress(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_publisher(max_batch_msgs=4)
+
+            msg_num = 10
+            msgs = ("message {}".format(index).encode(tests.ENCODING)
+                    for index in range(msg_num))
+
+            progress = []
+            for sent_num in pub.send_stream(msgs=msgs):
+                progress.append(sent_num)
+                # Every yielded count is already committed and hence a safe
+                # checkpoint.
+                assert pub.queue is not None
+                self.assertEqual(sent_num,
+                                 tests.count_data_entries(queue=pub.queue))
+
+            self.assertEqual([4, 8, 10], progress)
+
+    def test_topic_routing(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set={'all', 'metrics'})
+            control.set_subscription(
+                sub_id='metrics', topic_pattern='metrics.*')
+
+            pub = env.new_publisher()
+
+            pub.send(
+                msg="cpu load".encode(tests.ENCODING), topic='metrics.cpu')
+            pub.send(
+                msg="app log".encode(tests.ENCODING), topic='logs.app')
+            pub.send(msg="no topic".encode(tests.ENCODING))
+
+            assert pub.queue is not None
+            assert pub.queue.env is not None
+            with pub.queue.env.begin(write=False) as txn:
+                all_db = pub.queue.env.open_db(
+                    key='all'.encode(tests.ENCODING), txn=txn, create=False)
+                self.assertEqual(3, txn.stat(db=all_db)['entries'])
+
+                metrics_db = pub.queue.env.open_db(
+                    key='metrics'.encode(tests.ENCODING),
+                    txn=txn,
+                    create=False)
+                self.assertEqual(2, txn.stat(db=metrics_db)['entries'])
+
+    def test_group_commit_send(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_publisher(group_commit=True)
+
+            thread_num = 4
+            msg_per_thread = 10
+
+            def send_msgs() -> None:
+                for _ in range(msg_per_thread):
+                    pub.send(msg="group commit".encode(tests.ENCODING))
+
+            threads = [
+                threading.Thread(target=send_msgs)
+                for _ in range(thread_num)
+            ]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+
+            assert pub.queue is not None
+            self.assertEqual(thread_num * msg_per_thread,
+                             pub.queue.count_msgs())
+            pub.close()
+
+    def test_group_commit_flushed_on_close(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            pub = env.new_publisher(group_commit=True)
+
+            msg_num = 10
+            for _ in range(msg_num):
+                pub.send(msg="fire and forget".encode(tests.ENCODING),
+                         wait=False)
+
+            pub.close()
+
+            assert pub.queue is not None
+            self.assertEqual(msg_num, pub.queue.count_msgs())
 
 
 if __name__ == '__main__':
@@ -5,9 +5,11 @@ import time
 import unittest
 from typing import Set
 
+import lmdb
 import temppathlib
 
 import persipubsub.control
+import persipubsub.database
 import persipubsub.environment
 import persipubsub.queue
 import tests
@@ -77,10 +79,7 @@ class TestQueue(unittest.TestCase):
                 self.assertTrue(cursor.first())
                 key = cursor.key()
 
-                data_db = queue.env.open_db(
-                    key=tests.DATA_DB, txn=txn, create=False)
-
-                value = txn.get(key=key, db=data_db)
+                value = queue._get_data(txn=txn, key=key)
                 self.assertIsNotNone(value)
                 self.assertEqual(msg, value)
 
@@ -124,10 +123,7 @@ class TestQueue(unittest.TestCase):
 
                 self.assertEqual(key_0, key_1)
 
-                data_db = queue.env.open_db(
-                    key=tests.DATA_DB, txn=txn, create=False)
-
-                value = txn.get(key=key_1, db=data_db)
+                value = queue._get_data(txn=txn, key=key_1)
                 self.assertIsNotNone(value)
                 self.assertEqual(msg, value)
 
@@ -163,11 +159,35 @@ class TestQueue(unittest.TestCase):
                 sub_stat = txn.stat(db=sub_db)
                 self.assertEqual(msg_num, sub_stat['entries'])
 
-                data_db = queue.env.open_db(
-                    key=tests.DATA_DB, txn=txn, create=False)
+            self.assertEqual(msg_num, tests.count_data_entries(queue=queue))
+
+    def test_monotonic_binary_message_ids(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
 
-                data_stat = txn.stat(db=data_db)
-                self.assertEqual(msg_num, data_stat['entries'])
+            msg_num = 10
+            for index in range(msg_num):
+                queue.put(msg="msg {}".format(index).encode(tests.ENCODING))
+
+            assert queue.env is not None
+            with queue.env.begin(write=False) as txn:
+                cursor = txn.cursor(db=queue.meta_db)
+                keys = list(cursor.iternext(keys=True, values=False))
+
+            self.assertEqual(msg_num, len(keys))
+            for key in keys:
+                self.assertEqual(tests.BYTES_LENGTH, len(key))
+
+            # The IDs need to be strictly monotonic so that writes can use
+            # LMDB's append mode.
+            for previous_key, key in zip(keys, keys[1:]):
+                self.assertLess(previous_key, key)
 
     def test_front(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
@@ -188,6 +208,63 @@ class TestQueue(unittest.TestCase):
             self.assertIsNotNone(received_msg)
             self.assertEqual(msg, received_msg)
 
+    def test_front_empty_poll_fast_path(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            # The first empty poll caches the transaction ID, the second
+            # poll takes the fast path.
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertIsNone(received_msg)
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertIsNone(received_msg)
+
+            # A committed write invalidates the cached empty poll.
+            msg = "I'm a message.".encode(tests.ENCODING)
+            queue.put(msg=msg)
+
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertEqual(msg, received_msg)
+
+    def test_front_buffer(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            msg = "I'm a message.".encode(tests.ENCODING)
+
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            queue.put(msg=msg)
+
+            with queue.front_buffer(sub_id=subscriber) as (key, received_msg):
+                self.assertIsNotNone(key)
+                self.assertIsNotNone(received_msg)
+                assert received_msg is not None
+                self.assertEqual(msg, bytes(received_msg))
+
+    def test_front_buffer_empty(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            with queue.front_buffer(sub_id=subscriber) as (key, received_msg):
+                self.assertIsNone(key)
+                self.assertIsNone(received_msg)
+
     def test_pop(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             msg = "I'm a message.".encode(tests.ENCODING)
@@ -208,12 +285,7 @@ class TestQueue(unittest.TestCase):
 
             assert queue.env is not None
             with queue.env.begin() as txn:
-                pending_db = queue.env.open_db(
-                    key=tests.PENDING_DB, txn=txn, create=False)
-
-                cursor = txn.cursor(db=pending_db)
-                self.assertTrue(cursor.first())
-                pending_before_pop = cursor.value()
+                self.assertEqual(0, txn.stat(db=queue.ack_db)['entries'])
 
             queue.pop(sub_id=subscriber)
 
@@ -221,16 +293,174 @@ class TestQueue(unittest.TestCase):
 
             self.assertIsNone(received_msg)
 
+            # The pop recorded a blind ack mark instead of decrementing the
+            # pending count.
             with queue.env.begin() as txn:
-                pending_db = queue.env.open_db(
-                    key=tests.PENDING_DB, txn=txn, create=False)
-                cursor = txn.cursor(db=pending_db)
-                self.assertTrue(cursor.first())
-                pending_after_pop = cursor.value()
+                self.assertEqual(1, txn.stat(db=queue.ack_db)['entries'])
+
+    def test_pop_to_newest(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msg_num = 10
+            for index in range(msg_num):
+                queue.put(msg="message {}".format(index).encode(
+                    tests.ENCODING))
+
+            popped_num = queue.pop_to_newest(sub_id=subscriber)
+            self.assertEqual(msg_num - 1, popped_num)
+
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertEqual(
+                "message {}".format(msg_num - 1).encode(tests.ENCODING),
+                received_msg)
+
+            assert queue.env is not None
+            with queue.env.begin() as txn:
+                self.assertEqual(
+                    msg_num - 1, txn.stat(db=queue.ack_db)['entries'])
+
+    def test_zero_pending_index(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            queue.put(msg="I'm a message.".encode(tests.ENCODING))
+
+            assert queue.env is not None
+            with queue.env.begin() as txn:
+                self.assertEqual(
+                    0, txn.stat(db=queue.zero_pending_db)['entries'])
+
+            queue.front(sub_id=subscriber)
+            queue.pop(sub_id=subscriber)
+
+            # The pop wrote an ack mark; the fully consumed message is only
+            # evaluated lazily during pruning.
+            with queue.env.begin() as txn:
+                self.assertEqual(1, txn.stat(db=queue.ack_db)['entries'])
+                self.assertEqual(
+                    0, txn.stat(db=queue.zero_pending_db)['entries'])
+
+            queue.prune_dangling_messages()
+
+            self.assertEqual(0, queue.count_msgs())
+            with queue.env.begin() as txn:
+                self.assertEqual(0, txn.stat(db=queue.ack_db)['entries'])
+                self.assertEqual(
+                    0, txn.stat(db=queue.zero_pending_db)['entries'])
+
+    def test_config_epoch_refresh(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            _ = setup(env=env, sub_set={'sub'})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            assert queue.env is not None
+
+            # A control of another process holds its own queue snapshot, so
+            # its mutation only reaches this queue through the epoch bump.
+            foreign_control = persipubsub.control.initialize(
+                path=tmp_dir.path, env=queue.env)
+            foreign_control.set_subscription(sub_id='late', topic_pattern=None)
+
+            queue.put(msg="I'm a message.".encode(tests.ENCODING))
+
+            self.assertIn('late', queue.subscriber_ids)
+            with queue.env.begin() as txn:
+                late_db = queue.env.open_db(
+                    key='late'.encode(tests.ENCODING), txn=txn, create=False)
+                self.assertEqual(1, txn.stat(db=late_db)['entries'])
+
+    def test_cursor_subscriber(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set=set())
+            control.add_cursor_subscriber(sub_id='cur')
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            self.assertEqual({'cur'}, queue.cursor_subscriber_ids)
+
+            msgs = [
+                "message {}".format(index).encode(tests.ENCODING)
+                for index in range(3)
+            ]
+            for msg in msgs:
+                queue.put(msg=msg)
+
+            # The publish path wrote no per-subscriber key copies.
+            assert queue.env is not None
+            self.assertRaises(
+                lmdb.NotFoundError,
+                queue.env.open_db,
+                key='cur'.encode(tests.ENCODING),
+                create=False)
+
+            for expected_msg in msgs:
+                _, received_msg = queue.front(sub_id='cur')
+                self.assertEqual(expected_msg, received_msg)
+                queue.pop(sub_id='cur')
+
+            _, received_msg = queue.front(sub_id='cur')
+            self.assertIsNone(received_msg)
+
+    def test_cursor_subscriber_pop_to_newest(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set=set())
+            control.add_cursor_subscriber(sub_id='cur')
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msg_num = 10
+            for index in range(msg_num):
+                queue.put(msg="message {}".format(index).encode(
+                    tests.ENCODING))
+
+            popped_num = queue.pop_to_newest(sub_id='cur')
+            self.assertEqual(msg_num - 1, popped_num)
 
+            _, received_msg = queue.front(sub_id='cur')
             self.assertEqual(
-                int.from_bytes(pending_before_pop, tests.BYTES_ORDER) - 1,
-                int.from_bytes(pending_after_pop, tests.BYTES_ORDER))
+                "message {}".format(msg_num - 1).encode(tests.ENCODING),
+                received_msg)
+
+    def test_cursor_subscriber_retains_unconsumed(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set=set())
+            control.add_cursor_subscriber(sub_id='cur')
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            queue.put(msg="first".encode(tests.ENCODING))
+            queue.put(msg="second".encode(tests.ENCODING))
+
+            # No key-copy subscriber is pending, but the messages were not
+            # consumed by the cursor subscriber yet.
+            queue.prune_dangling_messages()
+            self.assertEqual(2, queue.count_msgs())
+
+            for _ in range(2):
+                queue.front(sub_id='cur')
+                queue.pop(sub_id='cur')
+
+            queue.prune_dangling_messages()
+            self.assertEqual(0, queue.count_msgs())
 
     def test_pop_queue_empty(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
@@ -302,6 +532,64 @@ class TestQueue(unittest.TestCase):
                 int(tests.TEST_HWM_MSG_NUM - int(tests.TEST_HWM_MSG_NUM / 2)),
                 queue.count_msgs())
 
+    def test_running_counters(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msg = "0123456789".encode(tests.ENCODING)
+            msg_num = 3
+            for _ in range(msg_num):
+                queue.put(msg=msg)
+
+            self.assertEqual(msg_num, queue.count_msgs())
+            self.assertEqual(msg_num * len(msg),
+                             queue.check_current_lmdb_size())
+
+            assert queue.hwm is not None
+            queue.hwm.message_timeout = 0
+            time.sleep(2)
+            queue.prune_dangling_messages()
+
+            self.assertEqual(0, queue.count_msgs())
+            self.assertEqual(0, queue.check_current_lmdb_size())
+
+    def test_amortized_cleanup(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            queue = env.new_publisher(
+                cleanup_interval_msgs=3 * tests.TEST_HWM_MSG_NUM,
+                cleanup_interval_secs=3600).queue
+            assert queue is not None
+
+            assert queue.hwm is not None
+            queue.hwm.max_messages = tests.TEST_HWM_MSG_NUM
+
+            msg = "hello world".encode(tests.ENCODING)
+
+            for _ in range(2 * tests.TEST_HWM_MSG_NUM):
+                queue.put(msg=msg)
+
+            # The high water mark is exceeded, but the cleanup is deferred
+            # until the maintenance interval elapses.
+            self.assertEqual(2 * tests.TEST_HWM_MSG_NUM, queue.count_msgs())
+
+            for _ in range(tests.TEST_HWM_MSG_NUM):
+                queue.put(msg=msg)
+
+            # The maintenance interval elapsed in between, hence the queue
+            # has been pruned back below the high water mark.
+            self.assertLess(queue.count_msgs(), 2 * tests.TEST_HWM_MSG_NUM)
+
     def test_overflow_limit_size(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             env = persipubsub.environment.Environment(path=tmp_dir.path)
@@ -414,6 +702,67 @@ class TestQueue(unittest.TestCase):
             self.assertEqual("secret message 0".encode(tests.ENCODING),
                              received_msg)
 
+    def test_blob_spillover(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set={'sub'})
+            control.set_blob_threshold(threshold_bytes=1024)
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            self.assertEqual(1024, queue.blob_threshold)
+
+            small_msg = b'small payload'
+            large_msg = b'x' * 2048
+            queue.put(msg=small_msg)
+            queue.put(msg=large_msg)
+
+            blob_dir = tmp_dir.path / persipubsub.database.BLOB_DIR
+            self.assertEqual(1, len(list(blob_dir.glob('*/*.blob'))))
+
+            key, received_msg = queue.front(sub_id='sub')
+            self.assertEqual(small_msg, received_msg)
+            queue.pop(sub_id='sub', msg_id=key)
+
+            _, received_msg = queue.front(sub_id='sub')
+            self.assertIsNotNone(received_msg)
+            self.assertIsInstance(received_msg, memoryview)
+            self.assertEqual(large_msg, received_msg)
+            queue.pop(sub_id='sub')
+
+            # Pruning the dangling messages removes the blob file as well.
+            queue.prune_dangling_messages()
+            self.assertEqual(0, len(list(blob_dir.glob('*/*.blob'))))
+
+    def test_compression(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+            control = setup(env=env, sub_set={'sub'})
+            control.set_compression(codec='zlib')
+
+            queue = env.new_publisher().queue
+            assert queue is not None
+            self.assertEqual('zlib', queue.compression)
+
+            msg = "compress me ".encode(tests.ENCODING) * 200
+            queue.put(msg=msg)
+
+            key, received_msg = queue.front(sub_id='sub')
+            self.assertEqual(msg, received_msg)
+
+            assert queue.env is not None
+            with queue.env.begin(write=False) as txn:
+                stored_value = txn.get(
+                    key=key, db=queue.data_db_for(msg_id=key, create=False))
+
+            self.assertTrue(
+                stored_value.startswith(
+                    persipubsub.database.COMPRESSION_MARKER))
+            self.assertLess(len(stored_value), len(msg))
+
+            self.assertRaises(
+                ValueError, control.set_compression, codec='snappy')
+
 
 if __name__ == '__main__':
     unittest.main()
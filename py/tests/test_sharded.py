@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+"""Test sharded queue."""
+
+import unittest
+
+import temppathlib
+
+import persipubsub.queue
+import persipubsub.sharded
+import tests
+
+# pylint: disable=missing-docstring
+# pylint: disable=protected-access
+
+
+class TestSharded(unittest.TestCase):
+    def test_shard_directories_created(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.sharded.ShardedEnvironment(
+                path=tmp_dir.path, shard_num=2)
+            _ = env.new_control(subscriber_ids={'sub'})
+
+            self.assertTrue((tmp_dir.path / 'shard_0').is_dir())
+            self.assertTrue((tmp_dir.path / 'shard_1').is_dir())
+            env.close()
+
+    def test_shard_num_discovered(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.sharded.ShardedEnvironment(
+                path=tmp_dir.path, shard_num=3)
+            _ = env.new_control(subscriber_ids={'sub'})
+            env.close()
+
+            reopened = persipubsub.sharded.ShardedEnvironment(
+                path=tmp_dir.path)
+            self.assertEqual(3, len(reopened.environments))
+            reopened.close()
+
+    def test_send_receive_merged_in_order(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.sharded.ShardedEnvironment(
+                path=tmp_dir.path, shard_num=2)
+            _ = env.new_control(subscriber_ids={'sub'})
+
+            pub = env.new_publisher()
+            sub = env.new_subscriber(identifier='sub')
+
+            msg_num = 10
+            for index in range(msg_num):
+                pub.send(msg="msg {}".format(index).encode(tests.ENCODING))
+
+            received = []
+            for _ in range(msg_num):
+                with sub.receive(timeout=2, retries=10) as msg:
+                    self.assertIsNotNone(msg)
+                    assert msg is not None
+                    received.append(msg.decode(tests.ENCODING))
+
+            self.assertListEqual(
+                ["msg {}".format(index) for index in range(msg_num)],
+                received)
+
+            with sub.receive(timeout=1, retries=2) as msg:
+                self.assertIsNone(msg)
+
+            env.close()
+
+    def test_send_many_spread_over_shards(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.sharded.ShardedEnvironment(
+                path=tmp_dir.path, shard_num=2)
+            _ = env.new_control(subscriber_ids={'sub'})
+
+            pub = env.new_publisher()
+
+            msg_num = 10
+            pub.send_many(msgs=[
+                "msg {}".format(index).encode(tests.ENCODING)
+                for index in range(msg_num)
+            ])
+
+            counts = []
+            for shard_env in env.environments:
+                queue = persipubsub.queue._Queue()
+                queue.init(path=shard_env.path, env=shard_env._env)
+                counts.append(queue.count_msgs())
+
+            self.assertEqual(msg_num, sum(counts))
+            self.assertTrue(all(count > 0 for count in counts))
+            env.close()
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,6 +1,8 @@
 #!/usr/bin/env python
 """Test subscriber."""
 
+import threading
+import time
 import unittest
 from typing import Set
 
@@ -47,6 +49,38 @@ class TestSubscriber(unittest.TestCase):
                 self.assertIsNotNone(received_msg)
                 self.assertEqual(msg, received_msg)
 
+    def test_notification_wakes_up_receive(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            sub = env.new_subscriber(identifier=subscriber)
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msg = "Hello World!".encode(tests.ENCODING)
+
+            def put_delayed() -> None:
+                time.sleep(0.5)
+                queue.put(msg=msg)
+
+            pub_thread = threading.Thread(target=put_delayed)
+            pub_thread.start()
+
+            # With timeout=10 and retries=2 the polling fallback alone would
+            # sleep 5 secs; the notification needs to wake up the subscriber
+            # much earlier.
+            start = time.time()
+            with sub.receive(timeout=10, retries=2) as received_msg:
+                duration = time.time() - start
+                self.assertIsNotNone(received_msg)
+                self.assertEqual(msg, received_msg)
+                self.assertLess(duration, 3)
+
+            pub_thread.join()
+
     def test_timeout_subscriber(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             env = persipubsub.environment.Environment(path=tmp_dir.path)
@@ -80,6 +114,45 @@ class TestSubscriber(unittest.TestCase):
             _, received_msg = queue.front(sub_id=subscriber)
             self.assertIsNone(received_msg)
 
+    def test_receive_many(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            sub = env.new_subscriber(identifier=subscriber)
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msgs = [
+                "message {}".format(index).encode(tests.ENCODING)
+                for index in range(5)
+            ]
+            for msg in msgs:
+                queue.put(msg=msg)
+
+            with sub.receive_many(max_msgs=3, timeout=1) as received_msgs:
+                self.assertListEqual(msgs[:3], received_msgs)
+
+            with sub.receive_many(max_msgs=10, timeout=1) as received_msgs:
+                self.assertListEqual(msgs[3:], received_msgs)
+
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertIsNone(received_msg)
+
+    def test_receive_many_empty(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            sub = env.new_subscriber(identifier=subscriber)
+
+            with sub.receive_many(timeout=1) as received_msgs:
+                self.assertListEqual([], received_msgs)
+
     def test_pop(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             env = persipubsub.environment.Environment(path=tmp_dir.path)
@@ -105,6 +178,77 @@ class TestSubscriber(unittest.TestCase):
                 self.assertIsNotNone(msg)
                 self.assertEqual(msg2, msg)
 
+    def test_deferred_ack(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            sub = env.new_subscriber(
+                identifier=subscriber,
+                deferred_ack=True,
+                ack_interval_msgs=100,
+                ack_interval_secs=3600)
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            msgs = [
+                "message {}".format(index).encode(tests.ENCODING)
+                for index in range(3)
+            ]
+            for msg in msgs:
+                queue.put(msg=msg)
+
+            for expected_msg in msgs:
+                with sub.receive(timeout=1) as received_msg:
+                    self.assertEqual(expected_msg, received_msg)
+
+            # The messages are acknowledged only in memory and still reside
+            # in the subscriber database until the acks are flushed.
+            assert queue.env is not None
+            with queue.env.begin(write=False) as txn:
+                sub_stat = txn.stat(db=queue.sub_db(sub_id=subscriber))
+                self.assertEqual(len(msgs), sub_stat['entries'])
+
+            sub.flush_acks()
+
+            with queue.env.begin(write=False) as txn:
+                sub_stat = txn.stat(db=queue.sub_db(sub_id=subscriber))
+                self.assertEqual(0, sub_stat['entries'])
+
+            _, received_msg = queue.front(sub_id=subscriber)
+            self.assertIsNone(received_msg)
+
+    def test_deferred_ack_flush_threshold(self) -> None:
+        with temppathlib.TemporaryDirectory() as tmp_dir:
+            env = persipubsub.environment.Environment(path=tmp_dir.path)
+
+            subscriber = 'sub'
+            _ = setup(env=env, sub_set={subscriber})
+
+            sub = env.new_subscriber(
+                identifier=subscriber,
+                deferred_ack=True,
+                ack_interval_msgs=2,
+                ack_interval_secs=3600)
+            queue = env.new_publisher().queue
+            assert queue is not None
+
+            for index in range(2):
+                queue.put(msg="message {}".format(index).encode(
+                    tests.ENCODING))
+
+            for _ in range(2):
+                with sub.receive(timeout=1) as received_msg:
+                    self.assertIsNotNone(received_msg)
+
+            # The count threshold is reached, hence the acks were flushed.
+            assert queue.env is not None
+            with queue.env.begin(write=False) as txn:
+                sub_stat = txn.stat(db=queue.sub_db(sub_id=subscriber))
+                self.assertEqual(0, sub_stat['entries'])
+
     def test_pop_when_empty(self) -> None:
         with temppathlib.TemporaryDirectory() as tmp_dir:
             env = persipubsub.environment.Environment(path=tmp_dir.path)